@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""把模型的 float32 NCHW 输入改为 uint8 NHWC 输入.
+
+类型转换、转置和归一化作为图节点加在原输入之前, C 端预处理只需缩放,
+输入张量大小为原来的 1/4. 程序加载模型时按输入类型自动选择预处理路径.
+
+用法:
+    python3 scripts/convert_u8_nhwc.py models/yolov5s.onnx models/yolov5s_u8.onnx --norm yolo
+    python3 scripts/convert_u8_nhwc.py models/ppocr_det_v4.onnx models/ppocr_det_v4_u8.onnx --norm imagenet
+    python3 scripts/convert_u8_nhwc.py models/ppocr_rec_v4.onnx models/ppocr_rec_v4_u8.onnx --norm ocr
+
+然后在 config/system.conf 的 [Models] 中指向转换后的模型. 依赖: pip install onnx numpy
+"""
+import argparse
+import sys
+
+import numpy as np
+import onnx
+from onnx import TensorProto, helper, numpy_helper
+
+# 与 src/image_utils.c 中 float 预处理一致: y = (x / 255 - mean) / std
+NORMS = {
+    "yolo": ([0.0, 0.0, 0.0], [1.0, 1.0, 1.0]),                    # preprocess_yolo
+    "imagenet": ([0.485, 0.456, 0.406], [0.229, 0.224, 0.225]),    # preprocess_dbnet
+    "ocr": ([0.5, 0.5, 0.5], [0.5, 0.5, 0.5]),                     # preprocess_ocr
+}
+
+
+def copy_dim(src, dst):
+    if src.HasField("dim_value"):
+        dst.dim_value = src.dim_value
+    elif src.HasField("dim_param"):
+        dst.dim_param = src.dim_param
+
+
+def convert(model, norm, dynamic_hw):
+    graph = model.graph
+    initializer_names = {init.name for init in graph.initializer}
+    inputs = [i for i in graph.input if i.name not in initializer_names]
+    if not inputs:
+        sys.exit("模型没有输入")
+    old = inputs[0]
+    if old.type.tensor_type.elem_type != TensorProto.FLOAT:
+        sys.exit("输入 %s 不是 float32, 可能已经转换过" % old.name)
+    dims = old.type.tensor_type.shape.dim
+    if len(dims) != 4 or (dims[1].HasField("dim_value") and dims[1].dim_value != 3):
+        sys.exit("输入 %s 不是 [N, 3, H, W]" % old.name)
+
+    name = old.name
+    float_name = name + "_normalized"
+
+    # 原输入的使用者改为读取归一化后的张量
+    for node in graph.node:
+        for k, inp in enumerate(node.input):
+            if inp == name:
+                node.input[k] = float_name
+    for out in graph.output:
+        if out.name == name:
+            sys.exit("输入直接作为输出, 无法转换")
+
+    # 新输入沿用原名称: [N, H, W, 3] uint8
+    new_input = helper.make_tensor_value_info(name, TensorProto.UINT8, None)
+    shape = new_input.type.tensor_type.shape
+    for src in (dims[0], dims[2], dims[3]):
+        copy_dim(src, shape.dim.add())
+    shape.dim.add().dim_value = 3
+    if dynamic_hw:
+        shape.dim[1].Clear()
+        shape.dim[1].dim_param = "height"
+        shape.dim[2].Clear()
+        shape.dim[2].dim_param = "width"
+
+    mean, std = NORMS[norm]
+    scale = np.array([1.0 / (255.0 * s) for s in std], dtype=np.float32).reshape(1, 3, 1, 1)
+    bias = np.array([-m / s for m, s in zip(mean, std)], dtype=np.float32).reshape(1, 3, 1, 1)
+    scale_name, bias_name = name + "_scale", name + "_bias"
+    graph.initializer.extend([
+        numpy_helper.from_array(scale, scale_name),
+        numpy_helper.from_array(bias, bias_name),
+    ])
+
+    prefix = [
+        helper.make_node("Cast", [name], [name + "_f32"], to=TensorProto.FLOAT, name=name + "_cast"),
+        helper.make_node("Transpose", [name + "_f32"], [name + "_nchw"], perm=[0, 3, 1, 2], name=name + "_transpose"),
+        helper.make_node("Mul", [name + "_nchw", scale_name], [name + "_scaled"], name=name + "_mul"),
+        helper.make_node("Add", [name + "_scaled", bias_name], [float_name], name=name + "_add"),
+    ]
+    nodes = prefix + list(graph.node)
+    del graph.node[:]
+    graph.node.extend(nodes)
+
+    idx = list(graph.input).index(old)
+    graph.input.remove(old)
+    graph.input.insert(idx, new_input)
+    return model
+
+
+def main():
+    ap = argparse.ArgumentParser(description="float32 NCHW 输入 -> uint8 NHWC 输入 (归一化在图内)")
+    ap.add_argument("src")
+    ap.add_argument("dst")
+    ap.add_argument("--norm", choices=sorted(NORMS), required=True,
+                    help="yolo: /255; imagenet: DBNet 车牌定位; ocr: (x/255-0.5)/0.5")
+    ap.add_argument("--dynamic-hw", action="store_true",
+                    help="输入高宽设为动态 (原模型须支持任意尺寸, 用于矩形车辆检测输入)")
+    args = ap.parse_args()
+
+    model = onnx.load(args.src)
+    convert(model, args.norm, args.dynamic_hw)
+    onnx.checker.check_model(model)
+    onnx.save(model, args.dst)
+
+    shape = [d.dim_param or d.dim_value for d in model.graph.input[0].type.tensor_type.shape.dim]
+    print("已保存 %s, 输入 %s uint8 %s" % (args.dst, model.graph.input[0].name, shape))
+
+
+if __name__ == "__main__":
+    main()
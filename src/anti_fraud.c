@@ -1,9 +1,15 @@
 #include "include/anti_fraud.h"
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+
+// 质量评估在固定尺寸的灰度缩略图上进行: 耗时与车牌截图大小无关,
+// 固定循环次数也便于编译器向量化
+#define Q_W 96
+#define Q_H 32
 
 bool detect_fraud(const Image* plate_image, const char* plate_text, 
-                  float ocr_confidence, char* fraud_reason) {
+                  float ocr_confidence, const PlateColorInfo* color, char* fraud_reason) {
     
     bool is_fraud = false;
     
@@ -29,51 +35,251 @@ bool detect_fraud(const Image* plate_image, const char* plate_text,
         return is_fraud;
     }
     
+    // 检查4: 底色与号牌种类不符 (如蓝底 8 位号牌)
+    if (!verify_plate_color(color, plate_text)) {
+        is_fraud = true;
+        strcpy(fraud_reason, "底色与号牌不符");
+        return is_fraud;
+    }
+    
     strcpy(fraud_reason, "正常");
     return is_fraud;
 }
 
 bool validate_plate_format(const char* plate_text) {
-    // 验证中国大陆车牌格式
+    // 验证中国大陆车牌格式: 省份简称 (UTF-8 三字节) + 6~7 位字母数字,
+    // 或 省份简称 + 5 位字母数字 + 特殊用途字 (学/警/挂/港/澳/使/领)
     int len = strlen(plate_text);
-    if (len < 7 || len > 8) return false;
+    if (len == 3 + 5 + 3) {
+        static const char* suffixes = "学警挂港澳使领";
+        bool suffix_ok = false;
+        for (const char* p = suffixes; *p; p += 3) {
+            if (memcmp(p, plate_text + 8, 3) == 0) { suffix_ok = true; break; }
+        }
+        if (!suffix_ok) return false;
+        len = 8;
+    } else if (len < 3 + 6 || len > 3 + 7) {
+        return false;
+    }
     
     // 检查省份简称
-    const char* provinces = "京津晋冀蒙辽吉黑沪苏浙皖闽赣鲁豫鄂湘粤桂琼川贵云藏陕甘青宁新渝";
-    if (strchr(provinces, plate_text[0]) == NULL) return false;
+    static const char* provinces = "京津晋冀蒙辽吉黑沪苏浙皖闽赣鲁豫鄂湘粤桂琼川贵云藏陕甘青宁新渝";
+    bool found = false;
+    for (const char* p = provinces; *p; p += 3) {
+        if (memcmp(p, plate_text, 3) == 0) { found = true; break; }
+    }
+    if (!found) return false;
     
-    // 检查后续字符 (字母和数字)
-    for (int i = 1; i < len; i++) {
-        if (!isalnum(plate_text[i])) return false;
+    // 检查后续字符 (字母和数字), 第二位必须是字母
+    if (!isupper((unsigned char)plate_text[3])) return false;
+    for (int i = 4; i < len; i++) {
+        if (!isalnum((unsigned char)plate_text[i])) return false;
     }
     
     return true;
 }
 
+// 最近邻缩放到 Q_W x Q_H 灰度图
+static void downsample_gray(const Image* img, uint8_t gray[Q_H][Q_W]) {
+    int xs[Q_W];
+    for (int x = 0; x < Q_W; x++) xs[x] = (x * img->width / Q_W) * img->channels;
+
+    for (int y = 0; y < Q_H; y++) {
+        const uint8_t* row = image_row(img, y * img->height / Q_H);
+        for (int x = 0; x < Q_W; x++) {
+            const uint8_t* p = row + xs[x];
+            gray[y][x] = (uint8_t)((77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8);
+        }
+    }
+}
+
+void assess_plate_quality(const Image* img, PlateQuality* q) {
+    memset(q, 0, sizeof(*q));
+    if (!img || !img->data || img->width < 4 || img->height < 4 || img->channels < 3) return;
+
+    uint8_t gray[Q_H][Q_W];
+    downsample_gray(img, gray);
+
+    // 亮度 / 对比度 / 过曝比例
+    int64_t sum = 0, sum_sq = 0;
+    int saturated = 0;
+    for (int y = 0; y < Q_H; y++) {
+        int32_t s = 0, ss = 0, sat = 0;
+        for (int x = 0; x < Q_W; x++) {
+            int32_t v = gray[y][x];
+            s += v;
+            ss += v * v;
+            sat += v >= 250;
+        }
+        sum += s;
+        sum_sq += ss;
+        saturated += sat;
+    }
+    const float n = (float)(Q_W * Q_H);
+    float mean = sum / n;
+    float var = sum_sq / n - mean * mean;
+
+    // 清晰度: 拉普拉斯方差
+    int64_t lsum = 0, lsum_sq = 0;
+    for (int y = 1; y < Q_H - 1; y++) {
+        const uint8_t* up = gray[y - 1];
+        const uint8_t* c = gray[y];
+        const uint8_t* dn = gray[y + 1];
+        int32_t s = 0, ss = 0;
+        for (int x = 1; x < Q_W - 1; x++) {
+            int32_t l = 4 * c[x] - c[x - 1] - c[x + 1] - up[x] - dn[x];
+            s += l;
+            ss += l * l;
+        }
+        lsum += s;
+        lsum_sq += ss;
+    }
+    const float ln = (float)((Q_W - 2) * (Q_H - 2));
+    float lmean = lsum / ln;
+    float lap_var = lsum_sq / ln - lmean * lmean;
+
+    q->brightness = mean / 255.0f;
+    q->contrast = sqrtf(var > 0 ? var : 0) / 128.0f;
+    q->glare = saturated / n;
+    q->sharpness = lap_var;
+
+    // 综合得分 (0-1): 清晰度、对比度为主, 过暗/过亮/反光扣分
+    float sharp_n = fminf(1.0f, lap_var / 400.0f);
+    float contrast_n = fminf(1.0f, q->contrast / 0.4f);
+    float exposure = 1.0f;
+    if (q->brightness < 0.15f) exposure = q->brightness / 0.15f;
+    else if (q->brightness > 0.85f) exposure = (1.0f - q->brightness) / 0.15f;
+    exposure *= 1.0f - fminf(1.0f, q->glare * 4.0f);
+    q->score = 0.45f * sharp_n + 0.30f * contrast_n + 0.25f * exposure;
+    if (exposure < 0.3f) q->score *= exposure / 0.3f; // 严重过曝/过暗直接判不可读
+}
+
 float assess_image_quality(const Image* img) {
-    // 简单的图像质量评估
-    // 这里可以实现更复杂的质量评估算法
-    
-    // 简化实现: 计算图像对比度
-    long sum = 0;
-    long count = img->width * img->height;
-    
-    for (int i = 0; i < count; i++) {
-        sum += img->data[i * img->channels]; // 使用R通道
+    PlateQuality q;
+    assess_plate_quality(img, &q);
+    return q.score;
+}
+
+// --- 车牌底色分类 ---
+// RGB 各取高 5 位 (32K 项) 预先算好 HSV 颜色类别, 分类时每个采样点只查一次表
+enum { CLS_OTHER = 0, CLS_BLUE, CLS_YELLOW, CLS_GREEN, CLS_WHITE, CLS_BLACK, CLS_COUNT };
+
+static uint8_t g_color_lut[1 << 15];
+static int g_color_lut_ready = 0;
+
+static int hsv_class(int r, int g, int b) {
+    int mx = r > g ? (r > b ? r : b) : (g > b ? g : b);
+    int mn = r < g ? (r < b ? r : b) : (g < b ? g : b);
+    int d = mx - mn;
+    float s = mx > 0 ? (float)d / mx : 0.0f;
+
+    if (mx < 70) return CLS_BLACK;
+    if (s < 0.22f) return mx >= 150 ? CLS_WHITE : CLS_OTHER;
+    if (s < 0.30f && mx < 100) return CLS_OTHER;
+
+    float h;
+    if (mx == r)      h = 60.0f * (g - b) / d;
+    else if (mx == g) h = 60.0f * (b - r) / d + 120.0f;
+    else              h = 60.0f * (r - g) / d + 240.0f;
+    if (h < 0) h += 360.0f;
+
+    if (h >= 190.0f && h < 255.0f) return CLS_BLUE;
+    if (h >= 25.0f && h < 68.0f) return CLS_YELLOW;
+    if (h >= 75.0f && h < 170.0f) return CLS_GREEN;
+    return CLS_OTHER;
+}
+
+void plate_color_init(void) {
+    if (g_color_lut_ready) return;
+    for (int i = 0; i < (1 << 15); i++) {
+        int r = ((i >> 10) & 31) << 3 | 4;
+        int g = ((i >> 5) & 31) << 3 | 4;
+        int b = (i & 31) << 3 | 4;
+        g_color_lut[i] = (uint8_t)hsv_class(r, g, b);
     }
-    
-    float avg_brightness = (float)sum / count / 255.0f;
-    
-    // 亮度在0.3-0.7之间认为质量较好
-    if (avg_brightness >= 0.3f && avg_brightness <= 0.7f) {
-        return 0.8f;
-    } else {
-        return 0.3f;
+    g_color_lut_ready = 1;
+}
+
+void classify_plate_color(const Image* img, PlateColorInfo* out) {
+    out->color = PLATE_COLOR_UNKNOWN;
+    out->confidence = 0.0f;
+    if (!img || !img->data || img->width < 4 || img->height < 4 || img->channels < 3) return;
+    if (!g_color_lut_ready) plate_color_init();
+
+    // 截图在定位框基础上外扩了约 1.8 x 2 倍, 只统计中间 60% x 50% 区域, 固定 Q_W x Q_H 采样
+    int x0 = img->width / 5, x1 = img->width - img->width / 5;
+    int y0 = img->height / 4, y1 = img->height - img->height / 4;
+    int xs[Q_W];
+    for (int x = 0; x < Q_W; x++) xs[x] = (x0 + x * (x1 - x0) / Q_W) * img->channels;
+
+    int hist[CLS_COUNT] = {0};
+    for (int y = 0; y < Q_H; y++) {
+        const uint8_t* row = image_row(img, y0 + y * (y1 - y0) / Q_H);
+        for (int x = 0; x < Q_W; x++) {
+            const uint8_t* p = row + xs[x];
+            hist[g_color_lut[(p[0] >> 3) << 10 | (p[1] >> 3) << 5 | p[2] >> 3]]++;
+        }
+    }
+
+    int classified = Q_W * Q_H - hist[CLS_OTHER];
+    if (classified < Q_W * Q_H / 4) return;
+
+    // 彩色底 (蓝/黄/绿) 优先: 白字/黑字只占小部分
+    int best = CLS_BLUE;
+    if (hist[CLS_YELLOW] > hist[best]) best = CLS_YELLOW;
+    if (hist[CLS_GREEN] > hist[best]) best = CLS_GREEN;
+    if (hist[best] < Q_W * Q_H / 5) {
+        // 白底黑字 / 黑底白字: 看哪种占多数
+        best = hist[CLS_WHITE] >= hist[CLS_BLACK] ? CLS_WHITE : CLS_BLACK;
+        if (hist[best] < Q_W * Q_H * 7 / 20) return;
     }
+
+    float conf = (float)hist[best] / classified;
+    if (conf < 0.4f) return;
+
+    static const PlateColor map[CLS_COUNT] = {
+        PLATE_COLOR_UNKNOWN, PLATE_COLOR_BLUE, PLATE_COLOR_YELLOW,
+        PLATE_COLOR_GREEN, PLATE_COLOR_WHITE, PLATE_COLOR_BLACK
+    };
+    out->color = map[best];
+    out->confidence = conf;
+}
+
+const char* plate_color_name(PlateColor c) {
+    switch (c) {
+        case PLATE_COLOR_BLUE:   return "blue";
+        case PLATE_COLOR_YELLOW: return "yellow";
+        case PLATE_COLOR_GREEN:  return "green";
+        case PLATE_COLOR_WHITE:  return "white";
+        case PLATE_COLOR_BLACK:  return "black";
+        default:                 return "unknown";
+    }
+}
+
+int plate_color_expected_len(PlateColor c) {
+    if (c == PLATE_COLOR_UNKNOWN) return 0;
+    return c == PLATE_COLOR_GREEN ? 8 : 7;
 }
 
-bool verify_plate_color(const Image* img) {
-    // 验证车牌颜色 (蓝色、黄色、绿色等)
-    // 简化实现: 总是返回true
+// 按 UTF-8 统计字符数
+static int utf8_char_count(const char* s) {
+    int n = 0;
+    for (; *s; s++) if (((unsigned char)*s & 0xC0) != 0x80) n++;
+    return n;
+}
+
+bool verify_plate_color(const PlateColorInfo* color, const char* plate_text) {
+    // 底色未知时不做判断
+    if (!color || color->color == PLATE_COLOR_UNKNOWN) return true;
+
+    // 号牌位数与底色不符: 绿牌 8 位, 其余 7 位
+    if (utf8_char_count(plate_text) != plate_color_expected_len(color->color)) return false;
+
+    // 新能源号牌: 第 3 位 (小型车) 或末位 (大型车) 为 D/F
+    if (color->color == PLATE_COLOR_GREEN) {
+        size_t len = strlen(plate_text);
+        char c3 = plate_text[4], last = plate_text[len - 1];
+        if (c3 != 'D' && c3 != 'F' && last != 'D' && last != 'F') return false;
+    }
     return true;
-}
\ No newline at end of file
+}
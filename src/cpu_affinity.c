@@ -0,0 +1,184 @@
+// CPU 拓扑探测与线程绑核
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "include/cpu_affinity.h"
+
+static int read_sys_int(const char* fmt, int cpu, int* value) {
+    char path[128];
+    snprintf(path, sizeof(path), fmt, cpu);
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    int ok = fscanf(f, "%d", value) == 1;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+int cpu_topology_detect(CpuTopology* topo) {
+    memset(topo, 0, sizeof(*topo));
+
+    cpu_set_t avail;
+    CPU_ZERO(&avail);
+    if (sched_getaffinity(0, sizeof(avail), &avail) != 0) {
+        printf("[Affinity] sched_getaffinity 失败: %s\n", strerror(errno));
+        return -1;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && topo->count < CPU_TOPO_MAX; cpu++) {
+        if (!CPU_ISSET(cpu, &avail)) continue;
+        int i = topo->count++;
+        topo->ids[i] = cpu;
+
+        // 大小核: 优先 cpufreq 最高频率, 其次 ARM 的 cpu_capacity
+        int khz = 0;
+        if (read_sys_int("/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu, &khz) != 0 &&
+            read_sys_int("/sys/devices/system/cpu/cpu%d/cpu_capacity", cpu, &khz) != 0) {
+            khz = 0;
+        }
+        topo->max_khz[i] = khz;
+        if (khz > topo->big_khz) topo->big_khz = khz;
+
+        int core = cpu, pkg = 0;
+        read_sys_int("/sys/devices/system/cpu/cpu%d/topology/core_id", cpu, &core);
+        read_sys_int("/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu, &pkg);
+        topo->core_key[i] = pkg * 65536 + core;
+
+        topo->smt_primary[i] = 1;
+        for (int j = 0; j < i; j++) {
+            if (topo->core_key[j] == topo->core_key[i]) {
+                topo->smt_primary[i] = 0;
+                topo->has_smt = 1;
+                break;
+            }
+        }
+    }
+    return topo->count > 0 ? 0 : -1;
+}
+
+int cpu_list_parse(const char* spec, cpu_set_t* set) {
+    CPU_ZERO(set);
+    const char* p = spec;
+    while (*p) {
+        char* end;
+        long a = strtol(p, &end, 10);
+        if (end == p || a < 0 || a >= CPU_SETSIZE) return -1;
+        long b = a;
+        p = end;
+        if (*p == '-') {
+            b = strtol(p + 1, &end, 10);
+            if (end == p + 1 || b < a || b >= CPU_SETSIZE) return -1;
+            p = end;
+        }
+        for (long c = a; c <= b; c++) CPU_SET((int)c, set);
+        while (*p == ' ') p++;
+        if (*p == ',') p++;
+        else if (*p) return -1;
+        while (*p == ' ') p++;
+    }
+    return 0;
+}
+
+void cpu_list_format(const cpu_set_t* set, int one_based, char* buf, size_t size) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int c = 0; c < CPU_SETSIZE && len + 1 < size; c++) {
+        if (!CPU_ISSET(c, set)) continue;
+        if (one_based) {
+            len += snprintf(buf + len, size - len, "%s%d", len ? ";" : "", c + 1);
+            continue;
+        }
+        int e = c;
+        while (e + 1 < CPU_SETSIZE && CPU_ISSET(e + 1, set)) e++;
+        if (e > c) len += snprintf(buf + len, size - len, "%s%d-%d", len ? "," : "", c, e);
+        else len += snprintf(buf + len, size - len, "%s%d", len ? "," : "", c);
+        c = e;
+    }
+    if (len >= size) buf[size - 1] = '\0';
+}
+
+// 配置项非空则按配置, 否则使用自动方案
+static void choose(const char* spec, const char* key, const cpu_set_t* fallback, cpu_set_t* out) {
+    if (spec[0] == '\0') {
+        *out = *fallback;
+        return;
+    }
+    if (cpu_list_parse(spec, out) != 0) {
+        printf("[Affinity] %s 无法解析: %s, 改用自动分配\n", key, spec);
+        *out = *fallback;
+    }
+}
+
+void cpu_placement_plan(const CpuTopology* topo, const AppConfig* cfg, CpuPlacement* out) {
+    memset(out, 0, sizeof(*out));
+    if (!cfg->affinity_enable) return;
+
+    // 自动方案: 大核 (频率最高的一簇) 的物理核中, 第一个给主循环, 其余给 ORT 全局线程池;
+    // 小核与超线程兄弟留给后台线程. 单核/双核机器上不拆分, 避免挤在一个核上
+    cpu_set_t capture, ort, io;
+    CPU_ZERO(&capture);
+    CPU_ZERO(&ort);
+    CPU_ZERO(&io);
+    int capture_cpu = -1, big_cores = 0;
+    for (int i = 0; i < topo->count; i++) {
+        int big = topo->max_khz[i] == topo->big_khz;
+        if (big && topo->smt_primary[i]) {
+            big_cores++;
+            if (capture_cpu < 0) {
+                capture_cpu = topo->ids[i];
+                CPU_SET(capture_cpu, &capture);
+            } else {
+                CPU_SET(topo->ids[i], &ort);
+            }
+        } else {
+            CPU_SET(topo->ids[i], &io);
+        }
+    }
+    if (big_cores < 3) {
+        // 核数太少: 只分出后台线程, 其余不绑定
+        CPU_ZERO(&capture);
+        CPU_ZERO(&ort);
+    }
+    if (CPU_COUNT(&io) == 0) {
+        // 没有小核/超线程: 后台线程与 ORT 共用 (它们大部分时间在睡眠)
+        io = ort;
+    }
+
+    choose(cfg->capture_cpus, "capture_cpus", &capture, &out->capture);
+    choose(cfg->io_cpus, "io_cpus", &io, &out->io);
+    choose(cfg->ort_cpus, "ort_cpus", &ort, &out->ort);
+}
+
+void cpu_placement_print(const CpuPlacement* p) {
+    static const char* names[] = { "采集/预处理", "后台 I/O", "ORT 线程池" };
+    const cpu_set_t* sets[] = { &p->capture, &p->io, &p->ort };
+    for (int i = 0; i < 3; i++) {
+        char buf[256];
+        cpu_list_format(sets[i], 0, buf, sizeof(buf));
+        printf("[Affinity] %s: CPU %s\n", names[i], buf[0] ? buf : "(不绑定)");
+    }
+}
+
+int cpu_pin_current_thread(const cpu_set_t* set, const char* what) {
+    if (CPU_COUNT(set) == 0) return 0;
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(*set), set);
+    if (err != 0) {
+        printf("[Affinity] %s 绑核失败: %s\n", what, strerror(err));
+        return -1;
+    }
+    return 0;
+}
+
+int cpu_set_fifo(int priority) {
+    struct sched_param sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = priority;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    if (err != 0) {
+        printf("[Affinity] SCHED_FIFO 设置失败 (需要 CAP_SYS_NICE): %s\n", strerror(err));
+        return -1;
+    }
+    printf("[Affinity] 主循环使用 SCHED_FIFO, 优先级 %d\n", priority);
+    return 0;
+}
@@ -0,0 +1,399 @@
+// 识别事件异步写盘 (有界 MPSC 队列 + 写盘线程)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#ifndef NO_JPEG
+#include <setjmp.h>
+#include <jpeglib.h>
+#endif
+#include "include/event_sink.h"
+#include "include/plate_store.h"
+#include "include/plate_list.h"
+#include "include/anti_fraud.h"
+
+// 队列单元: seq 用于无锁同步 (Vyukov 有界队列)
+typedef struct {
+    unsigned long seq;
+    DetectionResult result;
+    uint64_t event_id;
+    int64_t wall_time_us;
+} EventCell;
+
+static EventSinkConfig g_cfg;
+static EventCell* g_cells = NULL;
+static unsigned long g_mask = 0;
+static unsigned long g_enqueue_pos = 0;  // 多生产者, 原子更新
+static unsigned long g_dequeue_pos = 0;  // 仅写盘线程访问
+static uint64_t g_event_id = 0;
+
+static int g_wake_fd = -1;
+static pthread_t g_writer;
+static volatile int g_running = 0;
+static EventSinkStats g_stats;
+
+static FILE* g_jsonl = NULL;
+static FILE* g_bin = NULL;
+static char g_day[16] = "";
+
+// 墙钟与单调时钟之差 (us), 多个生产者线程共用, 原子访问
+static int64_t g_clock_offset = 0;
+#define CLOCK_STEP_US 1000  // 差值变化超过该值视为墙钟被调整 (NTP 步进、手动校时)
+
+// 单调时间戳 -> 墙钟. 每次分别读两个时钟再截断到 us 会有 ±1us 抖动, 使同一帧前后的记录时间倒退,
+// 存储因此提前封段; 这里沿用固定的差值, 只在检测到墙钟步进时更新
+static int64_t wall_time_of(uint64_t mono_us) {
+    struct timespec rt, mt;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    clock_gettime(CLOCK_MONOTONIC, &mt);
+    int64_t now_rt = (int64_t)rt.tv_sec * 1000000LL + rt.tv_nsec / 1000;
+    int64_t now_mt = (int64_t)mt.tv_sec * 1000000LL + mt.tv_nsec / 1000;
+    int64_t measured = now_rt - now_mt;
+    int64_t offset = __atomic_load_n(&g_clock_offset, __ATOMIC_RELAXED);
+    if (offset == 0 || measured - offset > CLOCK_STEP_US || offset - measured > CLOCK_STEP_US) {
+        offset = measured;
+        __atomic_store_n(&g_clock_offset, offset, __ATOMIC_RELAXED);
+    }
+    return (mono_us == 0 ? now_mt : (int64_t)mono_us) + offset;
+}
+
+static void stat_inc(unsigned long* v) {
+    __atomic_add_fetch(v, 1, __ATOMIC_RELAXED);
+}
+
+static void free_crop(DetectionResult* r) {
+    free(r->plate_img);
+    r->plate_img = NULL;
+}
+
+int event_sink_post(DetectionResult* r) {
+    if (!g_cells) { free_crop(r); return -1; }
+    stat_inc(&g_stats.posted);
+
+    unsigned long pos = __atomic_load_n(&g_enqueue_pos, __ATOMIC_RELAXED);
+    EventCell* cell;
+    for (;;) {
+        cell = &g_cells[pos & g_mask];
+        unsigned long seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&g_enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (diff < 0) {
+            // 队满: 丢弃整条记录, 处理线程绝不等待
+            stat_inc(&g_stats.dropped);
+            free_crop(r);
+            return -1;
+        } else {
+            pos = __atomic_load_n(&g_enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    // 背压: 队列积压超过水位时只保留记录, 丢弃截图
+    unsigned long backlog = pos - __atomic_load_n(&g_dequeue_pos, __ATOMIC_RELAXED);
+    if (r->plate_img && (!g_cfg.save_crops ||
+        backlog * 100 >= (g_mask + 1) * (unsigned long)g_cfg.crop_drop_percent)) {
+        if (g_cfg.save_crops) stat_inc(&g_stats.crops_dropped);
+        free_crop(r);
+    }
+
+    cell->result = *r;
+    cell->event_id = __atomic_add_fetch(&g_event_id, 1, __ATOMIC_RELAXED);
+    cell->wall_time_us = wall_time_of(r->frame_ts_us);
+    r->plate_img = NULL; // 所有权已转移
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+    uint64_t one = 1;
+    if (write(g_wake_fd, &one, sizeof(one)) < 0) { /* 计数器溢出才会失败, 写盘线程有超时兜底 */ }
+    return 0;
+}
+
+// --- 写盘线程 ---
+
+static void open_day_files(int64_t wall_us) {
+    time_t t = (time_t)(wall_us / 1000000);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    char day[16];
+    strftime(day, sizeof(day), "%Y%m%d", &tm);
+    if (strcmp(day, g_day) == 0) return;
+
+    if (g_jsonl) fclose(g_jsonl);
+    if (g_bin) fclose(g_bin);
+    g_jsonl = g_bin = NULL;
+    strcpy(g_day, day);
+
+    char path[512];
+    if (g_cfg.write_jsonl) {
+        snprintf(path, sizeof(path), "%s/%s.jsonl", g_cfg.output_dir, day);
+        g_jsonl = fopen(path, "a");
+        if (!g_jsonl) printf("[Events] 无法打开 %s: %s\n", path, strerror(errno));
+    }
+    if (g_cfg.write_binary) {
+        snprintf(path, sizeof(path), "%s/%s.bin", g_cfg.output_dir, day);
+        g_bin = fopen(path, "ab");
+        if (!g_bin) printf("[Events] 无法打开 %s: %s\n", path, strerror(errno));
+    }
+}
+
+#ifndef NO_JPEG
+// libjpeg 默认的 error_exit 调用 exit(): 磁盘写满等错误会结束整个识别进程, 改为跳回调用处
+typedef struct {
+    struct jpeg_error_mgr mgr;
+    jmp_buf jump;
+} JpegError;
+
+static void jpeg_error_exit(j_common_ptr cinfo) {
+    longjmp(((JpegError*)cinfo->err)->jump, 1);
+}
+#endif
+
+static int save_crop(const char* path, const unsigned char* rgb, int w, int h) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return -1;
+#ifndef NO_JPEG
+    struct jpeg_compress_struct cinfo;
+    JpegError jerr;
+    cinfo.err = jpeg_std_error(&jerr.mgr);
+    jerr.mgr.error_exit = jpeg_error_exit;
+    if (setjmp(jerr.jump)) {
+        // 写入失败: 丢弃不完整的截图, 由调用方计入写盘错误
+        jpeg_destroy_compress(&cinfo);
+        fclose(f);
+        unlink(path);
+        return -1;
+    }
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, f);
+    cinfo.image_width = w;
+    cinfo.image_height = h;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, g_cfg.jpeg_quality, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = (JSAMPROW)(rgb + (size_t)cinfo.next_scanline * w * 3);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+#else
+    fprintf(f, "P6\n%d %d\n255\n", w, h);
+    fwrite(rgb, 1, (size_t)w * h * 3, f);
+#endif
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static void write_event(EventCell* cell) {
+    DetectionResult* r = &cell->result;
+    open_day_files(cell->wall_time_us);
+
+    char crop_name[64] = "";
+    if (r->plate_img) {
+        // 以采集时间命名, 进程重启后事件编号重置也不会覆盖旧截图
+        snprintf(crop_name, sizeof(crop_name), "crops/%lld_%llu.%s",
+                 (long long)cell->wall_time_us, (unsigned long long)cell->event_id,
+#ifndef NO_JPEG
+                 "jpg"
+#else
+                 "ppm"
+#endif
+                 );
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", g_cfg.output_dir, crop_name);
+        if (save_crop(path, r->plate_img, r->plate_img_w, r->plate_img_h) != 0) {
+            stat_inc(&g_stats.write_errors);
+            crop_name[0] = '\0';
+        }
+        free_crop(r);
+    }
+
+    if (g_jsonl) {
+        fprintf(g_jsonl, "{\"id\":%llu,\"ts\":%lld.%06lld,\"plate\":",
+                (unsigned long long)cell->event_id,
+                (long long)(cell->wall_time_us / 1000000), (long long)(cell->wall_time_us % 1000000));
+        write_json_string(g_jsonl, r->plate_text);
+        fprintf(g_jsonl, ",\"conf\":%.3f,\"vehicle\":[%d,%d,%d,%d],\"plate_box\":[%d,%d,%d,%d],\"fraud\":%s",
+                r->confidence,
+                r->vehicle_bbox[0], r->vehicle_bbox[1], r->vehicle_bbox[2], r->vehicle_bbox[3],
+                r->plate_bbox[0], r->plate_bbox[1], r->plate_bbox[2], r->plate_bbox[3],
+                r->is_fraud ? "true" : "false");
+        fprintf(g_jsonl, ",\"ocr_conf\":%.3f,\"quality\":%.3f,\"color\":\"%s\"",
+                r->ocr_confidence, r->quality, plate_color_name((PlateColor)r->plate_color));
+        if (r->is_fraud) {
+            fputs(",\"fraud_reason\":", g_jsonl);
+            write_json_string(g_jsonl, r->fraud_reason);
+        }
+        if (r->list_type != PLATE_LIST_NONE) {
+            fprintf(g_jsonl, ",\"list\":\"%s\",\"list_plate\":",
+                    r->list_type == PLATE_LIST_DENY ? "deny" : "allow");
+            write_json_string(g_jsonl, r->list_plate);
+            fprintf(g_jsonl, ",\"list_distance\":%d", r->list_distance);
+        }
+        if (crop_name[0]) fprintf(g_jsonl, ",\"crop\":\"%s\"", crop_name);
+        if (r->evidence_update) fputs(",\"update\":true", g_jsonl);
+        fputs("}\n", g_jsonl);
+    }
+
+    // 截图更新: 同一辆车已记录过事件, 只补充更清晰的截图, 不再计入事件存储与名单告警
+    if (r->evidence_update) {
+        if (g_cfg.echo_console) {
+            printf("   [截图更新 %llu] 车牌: %s | 画质: %.2f\n", (unsigned long long)cell->event_id,
+                   r->plate_text, r->quality);
+        }
+        stat_inc(&g_stats.written);
+        return;
+    }
+
+    PlateRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.seq = cell->event_id;
+    rec.wall_time_us = cell->wall_time_us;
+    memcpy(rec.plate_text, r->plate_text, sizeof(rec.plate_text));
+    rec.confidence = r->confidence;
+    memcpy(rec.vehicle_bbox, r->vehicle_bbox, sizeof(rec.vehicle_bbox));
+    memcpy(rec.plate_bbox, r->plate_bbox, sizeof(rec.plate_bbox));
+    rec.is_fraud = r->is_fraud;
+    rec.has_crop = crop_name[0] != '\0';
+
+    if (g_bin && fwrite(&rec, sizeof(rec), 1, g_bin) != 1) stat_inc(&g_stats.write_errors);
+    if (g_cfg.store && plate_store_append(g_cfg.store, &rec) != 0) stat_inc(&g_stats.write_errors);
+
+    if (g_cfg.echo_console) {
+        const char* list = r->list_type == PLATE_LIST_DENY ? "黑名单" :
+                           r->list_type == PLATE_LIST_ALLOW ? "白名单" : "未登记";
+        printf("   [事件 %llu] 车牌: %s | 名单: %s%s%s | 欺诈: %s%s\n", (unsigned long long)cell->event_id,
+               r->plate_text, list,
+               r->list_type != PLATE_LIST_NONE && r->list_distance > 0 ? " (近似) " : "",
+               r->list_type != PLATE_LIST_NONE && r->list_distance > 0 ? r->list_plate : "",
+               r->is_fraud ? "YES (拦截) " : "NO (放行)", r->is_fraud ? r->fraud_reason : "");
+    }
+    stat_inc(&g_stats.written);
+}
+
+// 取出所有已就绪的事件, 返回处理条数
+static int drain() {
+    int n = 0;
+    for (;;) {
+        EventCell* cell = &g_cells[g_dequeue_pos & g_mask];
+        unsigned long seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        if ((long)(seq - (g_dequeue_pos + 1)) < 0) break;
+
+        write_event(cell);
+        // 单元交还给生产者
+        __atomic_store_n(&cell->seq, g_dequeue_pos + g_mask + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&g_dequeue_pos, g_dequeue_pos + 1, __ATOMIC_RELAXED);
+        n++;
+    }
+    if (n > 0) {
+        if (g_jsonl) fflush(g_jsonl);
+        if (g_bin) fflush(g_bin);
+    }
+    return n;
+}
+
+static void* writer_loop(void* arg) {
+    (void)arg;
+    int64_t last_maintain = 0;
+    while (__atomic_load_n(&g_running, __ATOMIC_ACQUIRE)) {
+        struct pollfd pfd = { .fd = g_wake_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 1000) > 0) {
+            uint64_t v;
+            if (read(g_wake_fd, &v, sizeof(v)) < 0) { /* EAGAIN */ }
+        }
+        int n = drain();
+
+        // 空闲时做存储维护 (过期删除 / 小段合并), 每分钟最多一次
+        int64_t now = wall_time_of(0);
+        if (g_cfg.store && n == 0 && now - last_maintain > 60LL * 1000000LL) {
+            plate_store_maintain(g_cfg.store, now);
+            last_maintain = now;
+        }
+    }
+    drain();
+    return NULL;
+}
+
+int event_sink_start(const EventSinkConfig* cfg) {
+    g_cfg = *cfg;
+    if (g_cfg.jpeg_quality < 1 || g_cfg.jpeg_quality > 100) g_cfg.jpeg_quality = 85;
+    if (g_cfg.crop_drop_percent <= 0 || g_cfg.crop_drop_percent > 100) g_cfg.crop_drop_percent = 50;
+
+    unsigned long size = 16;
+    while (size < (unsigned long)cfg->queue_size) size <<= 1;
+    g_cells = calloc(size, sizeof(EventCell));
+    if (!g_cells) return -1;
+    g_mask = size - 1;
+    for (unsigned long i = 0; i < size; i++) g_cells[i].seq = i;
+    g_enqueue_pos = g_dequeue_pos = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+
+    char path[512];
+    mkdir(g_cfg.output_dir, 0755);
+    snprintf(path, sizeof(path), "%s/crops", g_cfg.output_dir);
+    mkdir(path, 0755);
+
+    g_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_wake_fd < 0) {
+        free(g_cells);
+        g_cells = NULL;
+        return -1;
+    }
+
+    g_running = 1;
+    if (pthread_create(&g_writer, NULL, writer_loop, NULL) != 0) {
+        g_running = 0;
+        close(g_wake_fd);
+        free(g_cells);
+        g_cells = NULL;
+        return -1;
+    }
+    printf("[Events] 事件写入 %s (队列 %lu)\n", g_cfg.output_dir, size);
+    return 0;
+}
+
+void event_sink_get_stats(EventSinkStats* stats) {
+    stats->posted = __atomic_load_n(&g_stats.posted, __ATOMIC_RELAXED);
+    stats->written = __atomic_load_n(&g_stats.written, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&g_stats.dropped, __ATOMIC_RELAXED);
+    stats->crops_dropped = __atomic_load_n(&g_stats.crops_dropped, __ATOMIC_RELAXED);
+    stats->write_errors = __atomic_load_n(&g_stats.write_errors, __ATOMIC_RELAXED);
+}
+
+void event_sink_stop() {
+    if (!g_cells) return;
+    __atomic_store_n(&g_running, 0, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    if (write(g_wake_fd, &one, sizeof(one)) < 0) { /* 写盘线程有超时兜底 */ }
+    pthread_join(g_writer, NULL);
+
+    if (g_jsonl) fclose(g_jsonl);
+    if (g_bin) fclose(g_bin);
+    g_jsonl = g_bin = NULL;
+    g_day[0] = '\0';
+    close(g_wake_fd);
+    g_wake_fd = -1;
+    free(g_cells);
+    g_cells = NULL;
+
+    printf("[Events] 投递 %lu | 写入 %lu | 队满丢弃 %lu | 丢弃截图 %lu | 写入错误 %lu\n",
+           g_stats.posted, g_stats.written, g_stats.dropped, g_stats.crops_dropped, g_stats.write_errors);
+}
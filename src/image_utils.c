@@ -4,65 +4,92 @@
 #include <math.h>
 #include "include/image_utils.h"
 
-void crop_image_rgb(const unsigned char* src, int sw, int sh, int x, int y, int w, int h, unsigned char* dst) {
-    if (x < 0) x = 0; if (y < 0) y = 0;
-    if (x + w > sw) w = sw - x; if (y + h > sh) h = sh - y;
-    if (w <= 0 || h <= 0) return;
+Image image_wrap(const unsigned char* rgb, int w, int h) {
+    Image img = { (uint8_t*)rgb, w, h, 3, w * 3 };
+    return img;
+}
+
+Image image_rect(const Image* src, int x, int y, int w, int h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > src->width) w = src->width - x;
+    if (y + h > src->height) h = src->height - y;
+    if (w < 0) w = 0;
+    if (h < 0) h = 0;
+    Image view = { src->data + (size_t)y * image_stride(src) + (size_t)x * src->channels,
+                   w, h, src->channels, image_stride(src) };
+    return view;
+}
 
-    for(int i=0; i<h; i++) {
-        memcpy(dst + i*w*3, src + ((y+i)*sw + x)*3, w*3);
+void image_copy(const Image* src, unsigned char* dst) {
+    size_t row_bytes = (size_t)src->width * src->channels;
+    for (int i = 0; i < src->height; i++) {
+        memcpy(dst + i * row_bytes, image_row(src, i), row_bytes);
     }
 }
 
-void preprocess_yolo(const unsigned char* src, int w, int h, int target, float* dst) {
-    float scale = fminf((float)target/w, (float)target/h);
+void preprocess_yolo(const Image* src, int target_w, int target_h, float* dst) {
+    int w = src->width, h = src->height;
+    // 等比缩放贴到左上角, 右/下补零; 输入宽高比与画面一致时几乎没有补零
+    float scale = fminf((float)target_w/w, (float)target_h/h);
     int nw = (int)(w * scale);
     int nh = (int)(h * scale);
-    memset(dst, 0, 3 * target * target * sizeof(float));
+    int plane = target_w * target_h;
+    if (nw < target_w || nh < target_h) memset(dst, 0, 3 * plane * sizeof(float));
 
     for(int r=0; r<nh; r++) {
+        int sy = (int)(r / scale);
+        if(sy >= h) sy = h-1;
+        const uint8_t* row = image_row(src, sy);
         for(int c=0; c<nw; c++) {
             int sx = (int)(c / scale);
-            int sy = (int)(r / scale);
-            if(sx >= w) sx = w-1; if(sy >= h) sy = h-1;
-            int idx = (sy * w + sx) * 3;
+            if(sx >= w) sx = w-1;
+            const uint8_t* p = row + sx * 3;
             // NCHW, Normalize 0-1
-            dst[0*target*target + r*target + c] = src[idx+0] / 255.0f;
-            dst[1*target*target + r*target + c] = src[idx+1] / 255.0f;
-            dst[2*target*target + r*target + c] = src[idx+2] / 255.0f;
+            dst[0*plane + r*target_w + c] = p[0] / 255.0f;
+            dst[1*plane + r*target_w + c] = p[1] / 255.0f;
+            dst[2*plane + r*target_w + c] = p[2] / 255.0f;
         }
     }
 }
 
 // DBNet 预处理
-void preprocess_dbnet(const unsigned char* src, int src_w, int src_h, int target_size, float* dst) {
+void preprocess_dbnet(const Image* src, int target_size, float* dst) {
+    preprocess_dbnet_rect(src, target_size, target_size, dst);
+}
+
+void preprocess_dbnet_rect(const Image* src, int target_w, int target_h, float* dst) {
+    int src_w = src->width, src_h = src->height;
     // 1. 计算缩放
-    float scale = fminf((float)target_size/src_w, (float)target_size/src_h);
+    float scale = fminf((float)target_w/src_w, (float)target_h/src_h);
     int new_w = (int)(src_w * scale);
     int new_h = (int)(src_h * scale);
+    if (new_w > target_w) new_w = target_w;
+    if (new_h > target_h) new_h = target_h;
     
     // 初始化为 0
-    memset(dst, 0, 3 * target_size * target_size * sizeof(float));
+    memset(dst, 0, 3 * target_w * target_h * sizeof(float));
     
     // ImageNet 标准均值和方差 (PP-OCR 专用)
     float mean[] = {0.485f, 0.456f, 0.406f};
     float std[]  = {0.229f, 0.224f, 0.225f};
 
-    int plane_size = target_size * target_size;
+    int plane_size = target_w * target_h;
 
     for(int r = 0; r < new_h; r++) {
+        int src_y = (int)(r / scale);
+        if (src_y >= src_h) src_y = src_h - 1;
+        const uint8_t* row = image_row(src, src_y);
         for(int c = 0; c < new_w; c++) {
             int src_x = (int)(c / scale);
-            int src_y = (int)(r / scale);
             if (src_x >= src_w) src_x = src_w - 1;
-            if (src_y >= src_h) src_y = src_h - 1;
             
-            int src_idx = (src_y * src_w + src_x) * 3;
-            int dst_idx = r * target_size + c;
+            const uint8_t* p = row + src_x * 3;
+            int dst_idx = r * target_w + c;
 
-            float r_val = src[src_idx + 0] / 255.0f;
-            float g_val = src[src_idx + 1] / 255.0f;
-            float b_val = src[src_idx + 2] / 255.0f;
+            float r_val = p[0] / 255.0f;
+            float g_val = p[1] / 255.0f;
+            float b_val = p[2] / 255.0f;
 
             // 归一化
             dst[dst_idx + 0 * plane_size] = (r_val - mean[0]) / std[0];
@@ -72,10 +99,10 @@ void preprocess_dbnet(const unsigned char* src, int src_w, int src_h, int target
     }
 }
 
-void postprocess_yolo(float* data, int rows, float conf_thres, int w, int h, Detection* dets, int* count) {
+void postprocess_yolo(float* data, int rows, float conf_thres, int input_w, int input_h, int w, int h, Detection* dets, int* count) {
     *count = 0;
-    // 计算缩放比例，将 640x640 的坐标还原回实际分辨率
-    float scale = fminf(640.0f/w, 640.0f/h);
+    // 计算缩放比例，将 input_w x input_h 的坐标还原回实际分辨率 (与 preprocess_yolo 的等比缩放一致)
+    float scale = fminf((float)input_w/w, (float)input_h/h);
     
     // 偏移量计算   YOLOv5 Output: [1, 25200, 85]   0-3: box, 4: obj_conf, 5-84: class_conf
     for(int i=0; i<rows; i++) {
@@ -127,6 +154,24 @@ void postprocess_yolo(float* data, int rows, float conf_thres, int w, int h, Det
     }
 }
 
+void yolo_input_shape(int img_w, int img_h, int long_side, int fixed_h, int* input_w, int* input_h) {
+    long_side = long_side / 32 * 32;
+    if (long_side < 32) long_side = 32;
+    if (fixed_h > 0) {
+        *input_w = long_side;
+        *input_h = (fixed_h + 31) / 32 * 32;
+        return;
+    }
+    // 短边向上取整到 32 的倍数, 补零不超过 31 行/列
+    if (img_w >= img_h) {
+        *input_w = long_side;
+        *input_h = ((long_side * img_h + img_w - 1) / img_w + 31) / 32 * 32;
+    } else {
+        *input_h = long_side;
+        *input_w = ((long_side * img_w + img_h - 1) / img_h + 31) / 32 * 32;
+    }
+}
+
 void postprocess_dbnet(float* map, int mw, int mh, float thresh, int* x, int* y, int* w, int* h) {
     int min_x = mw, min_y = mh, max_x = 0, max_y = 0;
     int cnt = 0;
@@ -157,20 +202,146 @@ void postprocess_dbnet(float* map, int mw, int mh, float thresh, int* x, int* y,
     *h = max_y - min_y;
 }
 
-void preprocess_ocr(const unsigned char* src, int w, int h, float* dst) {
-    int tw = 320; int th = 48;
+int postprocess_dbnet_boxes(const float* map, int mw, int mh, float thresh, int min_pixels, Detection* boxes, int max) {
+    unsigned char* seen = calloc((size_t)mw * mh, 1);
+    int* stack = malloc((size_t)mw * mh * sizeof(int));
+    int n = 0;
+    if (!seen || !stack) {
+        free(seen);
+        free(stack);
+        return 0;
+    }
+
+    for (int i = 0; i < mw * mh; i++) {
+        if (seen[i] || map[i] <= thresh) continue;
+
+        // 4 邻域连通区域: 外接矩形与平均概率
+        int min_x = mw, min_y = mh, max_x = 0, max_y = 0, cnt = 0, top = 0;
+        float sum = 0.0f;
+        seen[i] = 1;
+        stack[top++] = i;
+        while (top > 0) {
+            int k = stack[--top];
+            int r = k / mw, c = k % mw;
+            if (c < min_x) min_x = c;
+            if (c > max_x) max_x = c;
+            if (r < min_y) min_y = r;
+            if (r > max_y) max_y = r;
+            sum += map[k];
+            cnt++;
+            int nb[4] = { c > 0 ? k - 1 : -1, c + 1 < mw ? k + 1 : -1, r > 0 ? k - mw : -1, r + 1 < mh ? k + mw : -1 };
+            for (int j = 0; j < 4; j++) {
+                if (nb[j] >= 0 && !seen[nb[j]] && map[nb[j]] > thresh) {
+                    seen[nb[j]] = 1;
+                    stack[top++] = nb[j];
+                }
+            }
+        }
+        // 点太少是噪点
+        if (cnt < min_pixels) continue;
+
+        Detection d = { (float)min_x, (float)min_y, (float)max_x, (float)max_y, sum / cnt, 0 };
+        if (n < max) {
+            boxes[n++] = d;
+        } else {
+            // 已满: 替换置信度最低的框
+            int low = 0;
+            for (int j = 1; j < n; j++) if (boxes[j].confidence < boxes[low].confidence) low = j;
+            if (d.confidence > boxes[low].confidence) boxes[low] = d;
+        }
+    }
+    free(seen);
+    free(stack);
+    return n;
+}
+
+void preprocess_ocr(const Image* src, int target_w, float* dst) {
+    int w = src->width, h = src->height;
+    int tw = target_w; int th = 48;
     float sx = (float)w / tw;
     float sy = (float)h / th;
     
     for(int r=0; r<th; r++) {
+        int oy = (int)(r * sy);
+        if(oy>=h) oy=h-1;
+        const uint8_t* row = image_row(src, oy);
         for(int c=0; c<tw; c++) {
             int ox = (int)(c * sx);
-            int oy = (int)(r * sy);
-            if(ox>=w) ox=w-1; if(oy>=h) oy=h-1;
-            int idx = (oy*w + ox)*3;
+            if(ox>=w) ox=w-1;
+            const uint8_t* p = row + ox * 3;
             // PP-OCR Rec Norm: (x/255 - 0.5)/0.5
             for(int k=0; k<3; k++)
-                dst[k*th*tw + r*tw + c] = (src[idx+k]/255.0f - 0.5f) / 0.5f;
+                dst[k*th*tw + r*tw + c] = (p[k]/255.0f - 0.5f) / 0.5f;
+        }
+    }
+}
+
+// --- uint8 NHWC 预处理: 归一化与转置在模型图内完成, 这里只做最近邻缩放 ---
+
+// 等比缩放贴到左上角, 空白处填 pad (对应 float 路径中补零的像素值)
+static void letterbox_u8(const Image* src, int tw, int th, const unsigned char pad[3], unsigned char* dst) {
+    int w = src->width, h = src->height;
+    float scale = fminf((float)tw / w, (float)th / h);
+    int nw = (int)(w * scale);
+    int nh = (int)(h * scale);
+    if (nw > tw) nw = tw;
+    if (nh > th) nh = th;
+
+    int* xs = malloc(nw * sizeof(int));
+    for (int c = 0; c < nw; c++) {
+        int sx = (int)(c / scale);
+        xs[c] = (sx >= w ? w - 1 : sx) * 3;
+    }
+    for (int r = 0; r < th; r++) {
+        unsigned char* d = dst + (size_t)r * tw * 3;
+        int c = 0;
+        if (r < nh) {
+            int sy = (int)(r / scale);
+            if (sy >= h) sy = h - 1;
+            const unsigned char* row = image_row(src, sy);
+            for (; c < nw; c++, d += 3) {
+                const unsigned char* p = row + xs[c];
+                d[0] = p[0]; d[1] = p[1]; d[2] = p[2];
+            }
+        }
+        for (; c < tw; c++, d += 3) {
+            d[0] = pad[0]; d[1] = pad[1]; d[2] = pad[2];
+        }
+    }
+    free(xs);
+}
+
+void preprocess_yolo_u8(const Image* src, int target_w, int target_h, unsigned char* dst) {
+    static const unsigned char pad[3] = { 0, 0, 0 };
+    letterbox_u8(src, target_w, target_h, pad, dst);
+}
+
+void preprocess_dbnet_u8(const Image* src, int target_size, unsigned char* dst) {
+    preprocess_dbnet_rect_u8(src, target_size, target_size, dst);
+}
+
+void preprocess_dbnet_rect_u8(const Image* src, int target_w, int target_h, unsigned char* dst) {
+    // float 路径归一化后补 0, 即像素值等于 ImageNet 均值
+    static const unsigned char pad[3] = { 124, 116, 104 };
+    letterbox_u8(src, target_w, target_h, pad, dst);
+}
+
+void preprocess_ocr_u8(const Image* src, int target_w, unsigned char* dst) {
+    int w = src->width, h = src->height;
+    int tw = target_w; int th = 48;
+    float sx = (float)w / tw;
+    float sy = (float)h / th;
+
+    for (int r = 0; r < th; r++) {
+        int oy = (int)(r * sy);
+        if (oy >= h) oy = h - 1;
+        const unsigned char* row = image_row(src, oy);
+        unsigned char* d = dst + (size_t)r * tw * 3;
+        for (int c = 0; c < tw; c++, d += 3) {
+            int ox = (int)(c * sx);
+            if (ox >= w) ox = w - 1;
+            const unsigned char* p = row + ox * 3;
+            d[0] = p[0]; d[1] = p[1]; d[2] = p[2];
         }
     }
 }
@@ -236,4 +407,39 @@ void nms_yolo(Detection* dets, int* count, float iou_thres) {
     
     *count = new_count; // 更新数量
     free(keep);
-}
\ No newline at end of file
+}
+int roi_bounds(const RoiPolygon* roi, int img_w, int img_h, int* x, int* y, int* w, int* h) {
+    *x = 0; *y = 0; *w = img_w; *h = img_h;
+    if (!roi || roi->count < 2) return 0;
+
+    int x1 = roi->x[0], y1 = roi->y[0], x2 = roi->x[0], y2 = roi->y[0];
+    for (int i = 1; i < roi->count; i++) {
+        if (roi->x[i] < x1) x1 = roi->x[i];
+        if (roi->y[i] < y1) y1 = roi->y[i];
+        if (roi->x[i] > x2) x2 = roi->x[i];
+        if (roi->y[i] > y2) y2 = roi->y[i];
+    }
+    if (x2 > img_w) x2 = img_w;
+    if (y2 > img_h) y2 = img_h;
+
+    // 区域过小 (或配置的坐标超出当前分辨率) 时退回整帧
+    if (x2 - x1 < 64 || y2 - y1 < 64) return 0;
+
+    *x = x1; *y = y1; *w = x2 - x1; *h = y2 - y1;
+    return 1;
+}
+
+int roi_contains(const RoiPolygon* roi, float x, float y) {
+    if (!roi || roi->count < 2) return 1;
+    if (roi->count == 2) {
+        return x >= roi->x[0] && x <= roi->x[1] && y >= roi->y[0] && y <= roi->y[1];
+    }
+
+    // 射线法
+    int inside = 0;
+    for (int i = 0, j = roi->count - 1; i < roi->count; j = i++) {
+        float xi = roi->x[i], yi = roi->y[i], xj = roi->x[j], yj = roi->y[j];
+        if ((yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi) inside = !inside;
+    }
+    return inside;
+}
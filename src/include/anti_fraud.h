@@ -4,11 +4,44 @@
 #include "image_utils.h"
 #include <stdbool.h>
 
+// 车牌截图质量 (在缩略灰度图上计算, 微秒级)
+typedef struct {
+    float sharpness;   // 拉普拉斯方差
+    float contrast;    // 灰度标准差 / 128
+    float glare;       // 过曝像素比例
+    float brightness;  // 平均亮度 0-1
+    float score;       // 综合得分 0-1, 用于 OCR 前过滤与最佳帧选择
+} PlateQuality;
+
+// 车牌底色, 决定号牌种类与位数
+typedef enum {
+    PLATE_COLOR_UNKNOWN = 0,
+    PLATE_COLOR_BLUE,    // 小型汽车, 7 位
+    PLATE_COLOR_YELLOW,  // 大型汽车/教练车/挂车, 7 位 (末位可为 学/挂)
+    PLATE_COLOR_GREEN,   // 新能源, 8 位
+    PLATE_COLOR_WHITE,   // 警车等, 7 位 (末位可为 警)
+    PLATE_COLOR_BLACK    // 使领馆/港澳入境, 7 位 (末位可为 使/领/港/澳)
+} PlateColor;
+
+typedef struct {
+    PlateColor color;    // 置信度不足时为 PLATE_COLOR_UNKNOWN
+    float confidence;    // 底色像素占已分类像素的比例
+} PlateColorInfo;
+
 // 函数声明
 bool detect_fraud(const Image* plate_image, const char* plate_text, 
-                  float ocr_confidence, char* fraud_reason);
+                  float ocr_confidence, const PlateColorInfo* color, char* fraud_reason);
 bool validate_plate_format(const char* plate_text);
 float assess_image_quality(const Image* img);
-bool verify_plate_color(const Image* img);
+void assess_plate_quality(const Image* img, PlateQuality* q);
+// 预计算 RGB -> 颜色类别查找表 (system_init 时调用一次)
+void plate_color_init(void);
+// HSV 直方图底色分类, 固定采样点数, 微秒级
+void classify_plate_color(const Image* img, PlateColorInfo* out);
+const char* plate_color_name(PlateColor c);
+// 该底色号牌的字符数, 0 = 未知
+int plate_color_expected_len(PlateColor c);
+// 识别结果与底色是否相符 (底色未知时返回 true)
+bool verify_plate_color(const PlateColorInfo* color, const char* plate_text);
 
 #endif
\ No newline at end of file
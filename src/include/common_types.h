@@ -1,15 +1,27 @@
 #ifndef COMMON_TYPES_H
 #define COMMON_TYPES_H
+#include <stddef.h>
 #include <stdint.h>
 
-// 基础图像结构 (RGB)
+// 基础图像结构 (RGB), 也用作另一幅图像中某个矩形区域的视图:
+// data 指向区域左上角像素, stride 为相邻两行的字节距离, 像素与原图共用, 不复制
 typedef struct {
     uint8_t* data;
     int width;
     int height;
     int channels; // 通常为3
+    int stride;   // 行跨度 (字节), 0 表示紧密排列 (width * channels)
 } Image;
 
+static inline int image_stride(const Image* img) {
+    return img->stride ? img->stride : img->width * img->channels;
+}
+
+// 第 y 行起始地址
+static inline const uint8_t* image_row(const Image* img, int y) {
+    return img->data + (size_t)y * image_stride(img);
+}
+
 // 检测框
 typedef struct {
     float x1, y1, x2, y2;
@@ -17,4 +29,12 @@ typedef struct {
     int class_id;
 } Detection;
 
+// 检测区域: 0 个点 = 整帧, 2 个点 = 矩形 (左上, 右下), 3 个以上 = 多边形
+#define ROI_MAX_POINTS 16
+typedef struct {
+    int count;
+    int x[ROI_MAX_POINTS];
+    int y[ROI_MAX_POINTS];
+} RoiPolygon;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <sched.h>
+#include <stddef.h>
+#include "utils.h" // AppConfig
+
+#define CPU_TOPO_MAX 256
+
+// 本进程可用 CPU 的拓扑 (来自 sched_getaffinity 与 /sys/devices/system/cpu)
+typedef struct {
+    int count;
+    int ids[CPU_TOPO_MAX];          // 逻辑 CPU 编号
+    int max_khz[CPU_TOPO_MAX];      // 最高频率, 用于区分大小核 (未知为 0)
+    int core_key[CPU_TOPO_MAX];     // 物理核标识, 超线程兄弟相同
+    int smt_primary[CPU_TOPO_MAX];  // 1: 该物理核的第一个逻辑 CPU
+    int big_khz;                    // 大核频率
+    int has_smt;
+} CpuTopology;
+
+// 线程放置方案; 集合为空表示不绑定
+typedef struct {
+    cpu_set_t capture;   // 采集 + 预处理主循环
+    cpu_set_t io;        // 写盘、配置监听等后台线程
+    cpu_set_t ort;       // ORT 全局算子内线程池 (三个模型共用)
+} CpuPlacement;
+
+int cpu_topology_detect(CpuTopology* topo);
+// 解析 "0-3,6" 形式的 CPU 列表, 成功返回 0
+int cpu_list_parse(const char* spec, cpu_set_t* set);
+// 格式化为 CPU 列表 ("0-3,6"); one_based 时每个 CPU 单独一项、编号从 1 开始、以 ';' 分隔 (ORT 线程亲和性格式)
+void cpu_list_format(const cpu_set_t* set, int one_based, char* buf, size_t size);
+// 按配置 (留空项按拓扑自动选择) 生成放置方案
+void cpu_placement_plan(const CpuTopology* topo, const AppConfig* cfg, CpuPlacement* out);
+void cpu_placement_print(const CpuPlacement* p);
+// 绑定当前线程; 集合为空时不做任何事
+int cpu_pin_current_thread(const cpu_set_t* set, const char* what);
+// 当前线程切换到 SCHED_FIFO
+int cpu_set_fifo(int priority);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef EVENT_SINK_H
+#define EVENT_SINK_H
+
+#include <stdint.h>
+#include "plate_recognition.h"
+
+// 识别结果异步落盘: 处理线程只入队, 写盘/JPEG 编码在独立线程完成
+
+struct PlateStore;
+
+typedef struct {
+    char output_dir[256];   // 输出目录 (记录按天分文件, 截图在 crops/ 子目录)
+    int queue_size;         // 队列容量 (向上取整到 2 的幂)
+    int crop_drop_percent;  // 队列占用达到该百分比后丢弃截图, 只保留记录
+    int jpeg_quality;       // 截图 JPEG 质量 (1-100)
+    int save_crops;         // 是否保存车牌截图
+    int write_jsonl;        // 写 JSONL 记录
+    int write_binary;       // 写定长二进制记录 (PlateRecord)
+    int echo_console;       // 写盘线程同时打印到终端
+    struct PlateStore* store; // 可选: 同时写入车牌事件存储 (由写盘线程追加与维护)
+} EventSinkConfig;
+
+// 二进制记录格式 (小端, 定长)
+typedef struct {
+    uint64_t seq;
+    int64_t  wall_time_us;  // 采集时刻 (Unix 时间, us)
+    char     plate_text[64];
+    float    confidence;
+    int32_t  vehicle_bbox[4];
+    int32_t  plate_bbox[4];
+    int32_t  is_fraud;
+    int32_t  has_crop;
+} PlateRecord;
+
+typedef struct {
+    unsigned long posted;
+    unsigned long written;
+    unsigned long dropped;       // 队满丢弃的记录
+    unsigned long crops_dropped; // 背压丢弃的截图
+    unsigned long write_errors;
+} EventSinkStats;
+
+int event_sink_start(const EventSinkConfig* cfg);
+// 非阻塞投递. 结果中的车牌截图所有权转移给 sink (入队失败也由 sink 释放)
+// 记录时间取结果的 frame_ts_us (截图所在帧). 返回 0 入队, -1 丢弃
+int event_sink_post(DetectionResult* result);
+void event_sink_get_stats(EventSinkStats* stats);
+// 排空队列后停止写盘线程
+void event_sink_stop();
+
+#endif
@@ -3,23 +3,47 @@
 
 #include "common_types.h"
 
-// YOLO 预处理 (Resize + Pad + Normalize)
-void preprocess_yolo(const unsigned char* src, int w, int h, int target_size, float* dst);
-// YOLO 后处理
-void postprocess_yolo(float* data, int num_rows, float conf_thres, int img_w, int img_h, Detection* dets, int* count);
+// 预处理直接读取整帧中的子区域视图 (image_rect), 抠图不复制像素
+
+// YOLO 预处理 (Resize + Pad + Normalize), 输入可为矩形 (宽高均为 32 的倍数)
+void preprocess_yolo(const Image* src, int target_w, int target_h, float* dst);
+// YOLO 后处理 (坐标还原到 img_w x img_h)
+void postprocess_yolo(float* data, int num_rows, float conf_thres, int input_w, int input_h, int img_w, int img_h, Detection* dets, int* count);
+// 选择车辆检测输入尺寸: 长边为 long_side, 短边按画面宽高比取 32 的倍数 (fixed_h > 0 时固定高度)
+void yolo_input_shape(int img_w, int img_h, int long_side, int fixed_h, int* input_w, int* input_h);
 
 // DBNet (车牌定位) 预处理
-void preprocess_dbnet(const unsigned char* src, int w, int h, int target_size, float* dst);
+void preprocess_dbnet(const Image* src, int target_size, float* dst);
+// 矩形输入版本 (整帧定位, 宽高均为 32 的倍数)
+void preprocess_dbnet_rect(const Image* src, int target_w, int target_h, float* dst);
 // DBNet 后处理 (从热力图找框)
 void postprocess_dbnet(float* map, int map_w, int map_h, float thresh, int* x, int* y, int* w, int* h);
+// 多框后处理 (整帧定位): 每个连通区域一个框 (热力图坐标 x1, y1, x2, y2, 置信度为区域平均概率),
+// 少于 min_pixels 的区域视为噪点; 超过 max 个时保留置信度最高的, 返回框数
+int postprocess_dbnet_boxes(const float* map, int map_w, int map_h, float thresh, int min_pixels, Detection* boxes, int max);
 
 // CRNN (文字识别) 预处理
-void preprocess_ocr(const unsigned char* src, int w, int h, float* dst);
+void preprocess_ocr(const Image* src, int target_w, float* dst);
+
+// uint8 NHWC 版本 (模型由 scripts/convert_u8_nhwc.py 转换, 归一化在图内), 只做缩放
+void preprocess_yolo_u8(const Image* src, int target_w, int target_h, unsigned char* dst);
+void preprocess_dbnet_u8(const Image* src, int target_size, unsigned char* dst);
+void preprocess_dbnet_rect_u8(const Image* src, int target_w, int target_h, unsigned char* dst);
+void preprocess_ocr_u8(const Image* src, int target_w, unsigned char* dst);
 
-// 图像裁剪
-void crop_image_rgb(const unsigned char* src, int src_w, int src_h, int x, int y, int w, int h, unsigned char* dst);
+// 紧密排列的 RGB 缓冲区作为图像
+Image image_wrap(const unsigned char* rgb, int w, int h);
+// 子区域视图 (裁剪到图像范围内, 可能为空), 与 src 共用像素
+Image image_rect(const Image* src, int x, int y, int w, int h);
+// 把视图的像素复制为紧密排列的 RGB 缓冲区 (width * height * 3), 如随结果输出的车牌截图
+void image_copy(const Image* src, unsigned char* dst);
 
 //nms
 void nms_yolo(Detection* dets, int* count, float iou_thres);
 
+// 检测区域的外接矩形 (裁剪到图像范围内); 未配置或过小时返回整帧, 返回 0 表示整帧
+int roi_bounds(const RoiPolygon* roi, int img_w, int img_h, int* x, int* y, int* w, int* h);
+// 点是否在检测区域内 (未配置时总是返回 1)
+int roi_contains(const RoiPolygon* roi, float x, float y);
+
 #endif
\ No newline at end of file
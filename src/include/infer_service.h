@@ -0,0 +1,77 @@
+#ifndef INFER_SERVICE_H
+#define INFER_SERVICE_H
+
+#include <stdint.h>
+#include <signal.h>
+#include "plate_recognition.h" // DetectionResult
+
+// 推理服务: plate_inferd 持有模型, 各采集进程 (每路摄像头一个) 通过共享内存提交帧.
+//
+// 客户端创建 memfd (帧槽位环) 与两个 eventfd (提交 / 完成), 经 unix socket 以 SCM_RIGHTS 传给服务端.
+// 采集直接转码到槽位中, 像素数据不经过 socket、不复制; 服务端把各客户端已就绪的帧合成一批处理
+// (车辆检测按批次推理, 各帧车辆的子流水线共用任务池), 结果写回同一槽位.
+
+#define INFER_MAGIC 0x46494C50u      // "PLIF"
+#define INFER_VERSION 3
+#define INFER_MAX_SLOTS 8
+#define INFER_MAX_RESULTS 8
+#define INFER_CROP_MIN (320 * 128 * 3) // 单个车牌截图区的最小大小; 实际按帧尺寸计算 (见 infer_shm_layout)
+
+// 槽位状态 (原子访问)
+enum { INFER_SLOT_FREE = 0, INFER_SLOT_READY, INFER_SLOT_DONE };
+
+// 握手消息, 随 3 个文件描述符 (memfd, 提交 eventfd, 完成 eventfd) 一起发送
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t result_size;   // sizeof(DetectionResult): 两端须由同一版本编译
+    uint32_t width, height;
+    uint32_t slots;
+    uint64_t shm_size;
+} InferHello;
+
+// 共享内存布局: [InferShmHeader] [槽位 0] [槽位 1] ...
+// 每个槽位: [InferSlot] [车牌截图 INFER_MAX_RESULTS * crop_max] [RGB 帧]
+typedef struct {
+    uint32_t state;
+    int32_t count;
+    int32_t vehicle_count;
+    int32_t status;             // 0 成功, -1 推理失败
+    uint64_t timestamp_us;
+    DetectionResult results[INFER_MAX_RESULTS];  // plate_img 无效, 截图见 crop_bytes / 截图区
+    uint32_t crop_bytes[INFER_MAX_RESULTS];
+} InferSlot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t slots;
+    uint64_t slot_bytes;
+    uint64_t crops_offset;      // 相对槽位起始
+    uint64_t crop_max;          // 单个车牌截图区大小 (字节), 更大的截图不回传
+    uint64_t frame_offset;      // 相对槽位起始
+} InferShmHeader;
+
+// 按帧尺寸与槽位数计算布局, 返回共享内存总大小. 截图区按帧宽的一半 x 帧高的 1/4 预留,
+// 覆盖扩张后的大车牌截图 (1080p 下约 960x270)
+uint64_t infer_shm_layout(int width, int height, int slots, InferShmHeader* hdr);
+
+// --- 服务端 (plate_inferd) ---
+// max_batch: 一批最多处理的帧数; batch_wait_ms: 有帧就绪后再等待其他客户端的时间
+// 运行到 *running 为 0; 须已 system_init
+int infer_server_run(const char* socket_path, int max_batch, int batch_wait_ms, volatile sig_atomic_t* running);
+
+// --- 客户端 (替代 process_frame) ---
+typedef struct InferClient InferClient;
+
+InferClient* infer_client_connect(const char* socket_path, int width, int height, int slots);
+// 下一个可写槽位的 RGB 缓冲区; 所有槽位都在等待结果时返回 NULL
+unsigned char* infer_client_frame(InferClient* c);
+// 提交 infer_client_frame 返回的缓冲区
+int infer_client_submit(InferClient* c, uint64_t timestamp_us);
+// 最早提交的一帧是否已处理完成 (不阻塞): 1 完成, 0 未完成或没有在途帧, -1 服务已断开
+int infer_client_ready(InferClient* c);
+// 等待最早提交的一帧处理完成; 结果用 free_results 释放. 超时或服务断开返回 -1
+int infer_client_wait(InferClient* c, int timeout_ms, DetectionResult** results, int* count, int* vehicle_count);
+void infer_client_close(InferClient* c);
+
+#endif
@@ -5,7 +5,6 @@
 #include <stdint.h>
 
 typedef struct {
-    OrtEnv* env;
     OrtSession* session;
     OrtSessionOptions* session_options;
     OrtMemoryInfo* memory_info;
@@ -13,15 +12,61 @@ typedef struct {
     char** output_names;
     size_t input_count;
     size_t output_count;
+    int64_t input_dims[8];   // 第 1 个输入的形状, 动态维度为 -1
+    size_t input_rank;
+    int input_u8;            // 1: uint8 NHWC 输入 (归一化与转置在图内), 0: float32 NCHW
+    char* path;
+    OrtSession* profile_session; // 非 NULL 时推理改用这个开启了 profiling 的会话
+    char provider[16];       // 实际使用的执行提供程序 (cpu / xnnpack / dnnl / openvino)
 } ONNXModel;
 
-int onnx_model_init(ONNXModel* model, const char* model_path);
+// 进程级 ORT 运行时配置: 所有模型共用一个环境、一组全局线程池和一个共享 arena 分配器
+typedef struct {
+    int intra_op_threads;      // 0 = ORT 默认 (物理核数)
+    int inter_op_threads;      // 仅并行执行模式使用
+    int allow_spinning;        // 线程池空闲时自旋等待 (降低延迟, 占用 CPU)
+    int graph_optimization;    // 0 关闭, 1 基础, 2 扩展, 3 全部
+    int parallel_execution;    // 1: 图内算子并行执行
+    char intra_affinity[1024]; // 算子内线程亲和性 (ORT 格式 "2;3;4", 编号从 1 开始), 设置后线程数 = 项数 + 1
+    // 各执行提供程序的选项, "键=值" 以逗号或空格分隔, 原样传给 ORT
+    char xnnpack_options[128];
+    char dnnl_options[128];
+    char openvino_options[128];
+    int shared_allocator;      // 输出: 共享分配器是否注册成功
+} OnnxRuntimeOptions;
+
+void onnx_runtime_default_options(OnnxRuntimeOptions* opts);
+// 创建共享环境, 须在第一个 onnx_model_init 之前调用 (未调用时按默认配置创建)
+int onnx_runtime_init(const OnnxRuntimeOptions* opts);
+// 所有模型释放后释放共享环境
+void onnx_runtime_shutdown(void);
+// providers: 执行提供程序候选链, 如 "xnnpack,cpu"; 依次尝试注册并创建会话, 全部失败时退回 cpu.
+// NULL 或空串即 "cpu". 实际使用的见 model->provider
+int onnx_model_init(ONNXModel* model, const char* model_path, const char* providers);
 int onnx_model_predict(ONNXModel* model, 
                        const float* input_data, 
                        const int64_t* input_shape, 
                        size_t shape_len, 
                        float** output_data, 
                        size_t* output_size);
+// uint8 输入 (NHWC, 由 scripts/convert_u8_nhwc.py 转换的模型)
+int onnx_model_predict_u8(ONNXModel* model, const uint8_t* input_data, const int64_t* input_shape,
+                          size_t shape_len, float** output_data, size_t* output_size);
+// 按模型输入类型运行一张图: input 为 float32 NCHW 或 uint8 NHWC (见 input_u8), 形状由宽高构造
+int onnx_model_run_image(ONNXModel* model, const void* input, int height, int width,
+                         float** output_data, size_t* output_size);
+// 一次运行 batch 张同尺寸的图 (连续存放); 输出按批次顺序连续存放
+int onnx_model_run_batch(ONNXModel* model, const void* input, int batch, int height, int width,
+                         float** output_data, size_t* output_size);
+// 批次维度是否为动态 (可一次输入多张图)
+int onnx_model_dynamic_batch(const ONNXModel* model);
+// 模型是否以固定宽高导出; 是则返回 1 并给出宽高
+int onnx_model_fixed_hw(const ONNXModel* model, int* height, int* width);
+// ORT 会话不能中途开启 profiling: 另建一个开启 profiling 的会话临时替换原会话.
+// 两者都须在没有推理进行时调用 (帧间); prefix 为输出文件前缀
+int onnx_model_profile_begin(ONNXModel* model, const char* prefix);
+// 结束 profiling 并换回原会话, 给出 ORT 写出的文件名与起始时间 (CLOCK_REALTIME, ns)
+int onnx_model_profile_end(ONNXModel* model, char* file, size_t file_size, uint64_t* start_ns);
 void onnx_model_cleanup(ONNXModel* model);
 
 #endif
\ No newline at end of file
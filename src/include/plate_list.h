@@ -0,0 +1,33 @@
+#ifndef PLATE_LIST_H
+#define PLATE_LIST_H
+
+// 白名单/黑名单匹配: 支持精确匹配与易混字符 (O/0/D, I/1, 8/B, 2/Z, 5/S, 6/G)
+// 及有限编辑距离的模糊匹配
+//
+// 名单文件每行一个车牌, 可选类型: "京A12345,allow" / "京B88888,deny" (缺省 allow)
+// 加载时编译为排序后的 <名单文件>.idx, 之后直接 mmap 使用
+
+enum {
+    PLATE_LIST_NONE  = 0,
+    PLATE_LIST_ALLOW = 1,
+    PLATE_LIST_DENY  = 2
+};
+
+typedef struct {
+    int type;           // PLATE_LIST_*; NONE 表示未命中
+    int distance;       // 0: 完全一致或仅易混字符不同; >0: 编辑距离 (按字符计)
+    int exact;          // 1: 与名单中的车牌逐字一致
+    char plate[16];     // 命中的名单车牌
+} PlateListMatch;
+
+// 加载名单并原子替换当前名单; 匹配中的线程继续使用旧名单直到返回
+int plate_list_load(const char* path);
+// 在当前名单中查找, max_edits 为允许的最大编辑距离 (易混字符不计入);
+// 白名单条目只在距离不超过 allow_max_edits 时命中 (近似读数不应放行, 黑名单仍按 max_edits 告警)
+// 返回 1 命中, 0 未命中
+int plate_list_match(const char* plate, int max_edits, int allow_max_edits, PlateListMatch* out);
+// 当前名单条数
+int plate_list_size();
+void plate_list_unload();
+
+#endif
@@ -2,19 +2,83 @@
 #define PLATE_RECOGNITION_H
 
 #include "utils.h" // AppConfig
+#include "cpu_affinity.h"
+#include "trace.h"
 
 typedef struct {
     char plate_text[64];
     float confidence;
-    int vehicle_bbox[4]; // x, y, w, h
+    int vehicle_bbox[4]; // x, y, w, h (只检测车牌模式下为 0)
     int plate_bbox[4];   // x, y, w, h
     int is_fraud;        // 1: 欺诈, 0: 正常
+    char fraud_reason[32];
+    float ocr_confidence; // 输出字符的平均置信度
+    float quality;        // 车牌截图质量得分 (0-1)
+    int plate_color;      // PlateColor: 车牌底色 (0 = 未知)
+    float color_confidence;
+    unsigned char* plate_img;      // 车牌截图 (RGB), 由结果持有, 可为 NULL
+    int plate_img_w, plate_img_h;
+    int list_type;       // 名单匹配结果: PLATE_LIST_NONE / ALLOW / DENY
+    int list_distance;   // 0: 一致或仅易混字符不同, >0: 编辑距离
+    char list_plate[16]; // 命中的名单车牌
+    int evidence_update; // 1: 该车已输出过事件, 本结果只是同一读数的更清晰截图
+    uint64_t frame_ts_us; // 截图所在帧的采集时间 (MONOTONIC, us)
 } DetectionResult;
 
-// 初始化模型
-int system_init(AppConfig* config);
-// 处理一帧
-DetectionResult* process_frame(unsigned char* rgb_data, int width, int height, int* count);
+// 一帧各阶段耗时 (ms); 车牌定位与 OCR 为各车辆耗时之和, 并行时可能大于 vehicles_ms
+typedef struct {
+    double total_ms;
+    double vehicle_pre_ms;   // 检测区域抠图 + 车辆检测预处理
+    double vehicle_infer_ms; // 车辆检测推理 + 后处理 + NMS
+    double vehicles_ms;      // 全部车辆子流水线 (墙钟时间)
+    double plate_frame_ms;   // 整帧车牌定位 (Pipeline mode 为 frame / plate_only 时)
+    double plate_ms;         // 车辆抠图 + 车牌定位 (整帧定位时不含定位推理)
+    double ocr_ms;           // 质量把关 + 底色 + OCR + 校验
+    int vehicles;
+    int ocr_runs[3];         // 分级识别各级推理次数: [快速, 完整, 重新抠图]
+} FrameTiming;
+
+// 每路视频流的状态 (车辆跟踪、帧号、上一帧统计); process_frame 使用内部的默认实例
+typedef struct FrameContext FrameContext;
+
+// 批量处理的一帧: 输入图像与所属视频流, 输出结果
+typedef struct {
+    const unsigned char* rgb;
+    int width, height;
+    uint64_t timestamp_us;      // 帧的采集时间 (MONOTONIC, us), 原样写入各结果
+    FrameContext* ctx;          // NULL 表示默认实例
+    DetectionResult* results;   // 输出, 用 free_results 释放
+    int count;
+    int vehicle_count;          // 检测到的车辆数 (含未识别出车牌的车辆; 只检测车牌模式下为车牌数)
+    int status;                 // 0 成功, -1 车辆检测或整帧车牌定位推理失败 (结果为空)
+} FrameRequest;
+
+// 初始化模型; placement 指定各模型 ORT 线程池绑定的 CPU (可为 NULL)
+int system_init(AppConfig* config, const CpuPlacement* placement);
+// 处理一帧; timestamp_us 为帧的采集时间, 写入各结果的 frame_ts_us
+DetectionResult* process_frame(unsigned char* rgb_data, int width, int height, uint64_t timestamp_us, int* count);
+// 同时处理多帧 (可来自不同视频流): 输入尺寸相同的帧合并为一个批次做车辆检测,
+// 各帧的车辆子流水线在同一个任务池中并行. 同一 ctx 不能在一批中出现两次.
+// 有帧推理失败时返回 -1 (见各帧 status)
+int process_frames(FrameRequest* reqs, int n);
+FrameContext* frame_context_create();
+void frame_context_destroy(FrameContext* ctx);
+// 上一帧检测到的车辆数 (含未识别出车牌的车辆), 用于判断车道是否活跃
+int last_frame_vehicle_count();
+// 上一帧各阶段耗时
+void last_frame_timing(FrameTiming* out);
+// 上一帧出现的车辆中已有读数者的最佳读数 (含本帧因画质没有提升而跳过 OCR 的车辆), 返回个数
+int last_frame_track_readings(char texts[][64], int max);
+// 清空车辆跟踪 (离线评估时各图片互不相关, 避免把相邻图片中位置相近的车当成同一辆而跳过 OCR)
+void reset_vehicle_tracks();
+// 释放 process_frame 返回的结果 (含未转移所有权的车牌截图)
+void free_results(DetectionResult* results, int count);
+// 追踪期间三个模型改用开启 ORT profiling 的会话 (帧间调用, 重建会话需要数百毫秒)
+int system_profiling_begin(const char* dir);
+// 结束 profiling 并换回原会话, 填写各模型的 profiling 文件, 返回个数
+int system_profiling_end(TraceOrtProfile* out, int max);
+// 各模型实际使用的执行提供程序, 如 "vehicle=xnnpack plate=xnnpack ocr=cpu"
+void system_providers(char* buf, size_t size);
 // 清理
 void system_cleanup();
 
@@ -0,0 +1,39 @@
+#ifndef PLATE_STORE_H
+#define PLATE_STORE_H
+
+#include <stdint.h>
+#include "event_sink.h" // PlateRecord
+
+// 车牌事件存储: 分段追加写 + mmap 有序索引 (车牌, 时间)
+//   <dir>/seg_XXXXXXXX.dat  PlateRecord 定长记录, 按时间追加
+//   <dir>/seg_XXXXXXXX.idx  封存后生成的排序索引, 查询时 mmap
+
+typedef struct {
+    char dir[256];
+    int segment_records;   // 活动段达到该记录数后封存 (活动段在内存中线性扫描)
+    int merge_records;     // 小段合并 (compaction) 的目标记录数
+    int retention_days;    // 超过保留期的段整体删除 (0 = 不删除)
+    int read_only;         // 只读打开 (查询工具), 不写入也不封存段
+} PlateStoreConfig;
+
+typedef struct PlateStore PlateStore;
+
+PlateStore* plate_store_open(const PlateStoreConfig* cfg);
+void plate_store_close(PlateStore* store);
+
+// 追加一条记录 (单写者)
+int plate_store_append(PlateStore* store, const PlateRecord* rec);
+
+// 查询: plate_prefix 为 NULL 或空串时只按时间过滤; 时间为 Unix us, 闭区间
+// 返回最近的至多 max_out 条 (按时间倒序)
+int plate_store_query(PlateStore* store, const char* plate_prefix,
+                      int64_t from_us, int64_t to_us,
+                      PlateRecord* out, int max_out);
+
+// 维护: 过期段删除 + 小段合并. 在写线程空闲时调用
+void plate_store_maintain(PlateStore* store, int64_t now_us);
+
+// 车牌归一化 (去分隔符, 字母转大写), 与索引键一致
+void plate_store_normalize(const char* plate, char* key, int key_size);
+
+#endif
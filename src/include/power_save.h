@@ -0,0 +1,45 @@
+#ifndef POWER_SAVE_H
+#define POWER_SAVE_H
+
+#include <stdint.h>
+#include "common_types.h" // RoiPolygon
+
+// 空闲省电配置 (来自 system.conf)
+typedef struct {
+    int enable;
+    int idle_after_s;       // 持续无车多久后进入省电
+    int width, height, fps; // 省电时的采集分辨率与帧率
+    int cell_delta;         // 网格平均亮度变化超过该值 (0-255) 视为变化
+    float motion_cells;     // 检测区域内变化网格的占比超过该值视为有运动
+} PowerSaveConfig;
+
+#define MOTION_GRID_W 32
+#define MOTION_GRID_H 18
+
+// 省电状态机: 全速时统计车道空闲时长, 省电时在 YUYV 亮度网格上做占用检查 (不转码、不推理)
+typedef struct {
+    PowerSaveConfig cfg;
+    int idle;                    // 1: 省电中
+    uint64_t last_activity;      // 最近一次检测到车辆的时间 (us)
+    uint64_t idle_since;
+    float background[MOTION_GRID_H][MOTION_GRID_W]; // 各网格的背景亮度
+    unsigned char mask[MOTION_GRID_H][MOTION_GRID_W]; // 网格中心是否在检测区域内
+    int warmup;                  // 切换后自动曝光稳定前跳过的帧数
+    int changed, cells;          // 上一次检查中变化的网格数 / 参与检查的网格数
+
+    // 统计
+    unsigned long entries;
+    double idle_seconds;
+} PowerSave;
+
+void power_save_init(PowerSave* ps, const PowerSaveConfig* cfg);
+// 全速处理完一帧后回报本帧车辆数; 返回 1 表示应进入省电
+int power_save_complete(PowerSave* ps, uint64_t now_us, int vehicles);
+// 进入省电: roi 为原始帧坐标的检测区域, full_w/full_h 为原始帧尺寸 (网格按比例映射, 与省电分辨率无关)
+void power_save_enter(PowerSave* ps, uint64_t now_us, const RoiPolygon* roi, int full_w, int full_h);
+// 省电中的一帧 (YUYV): 返回 1 表示检测区域内画面有变化, 应恢复全速
+int power_save_motion(PowerSave* ps, const unsigned char* yuyv, int w, int h);
+// 恢复全速
+void power_save_leave(PowerSave* ps, uint64_t now_us);
+
+#endif
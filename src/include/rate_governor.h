@@ -0,0 +1,51 @@
+#ifndef RATE_GOVERNOR_H
+#define RATE_GOVERNOR_H
+
+#include <stdint.h>
+
+// 调度器配置 (来自 system.conf)
+typedef struct {
+    int idle_interval_ms;   // 空闲车道的处理间隔 (processing_interval)
+    int latency_budget_ms;  // 端到端延迟预算: V4L2 缓冲时间戳 -> 识别结果
+    int activity_hold_ms;   // 检测到车辆后保持全速处理的时长
+} GovernorConfig;
+
+// 自适应处理速率调度器
+typedef struct {
+    GovernorConfig cfg;
+    float interval_ms;        // 当前两次处理之间的最小间隔
+    float proc_ewma_ms;       // 单帧处理耗时 (指数滑动平均)
+    float latency_ewma_ms;    // 端到端延迟 (指数滑动平均)
+    uint64_t last_admit_ts;   // 上一次放行帧的时间戳 (us)
+    uint64_t active_until;    // 车道活跃截止时间 (us)
+
+    // 统计
+    unsigned long processed;
+    unsigned long skipped;
+    unsigned long dropped;
+    unsigned long over_budget;
+    double latency_sum_ms;
+    float latency_max_ms;
+    uint64_t last_report;
+} RateGovernor;
+
+// governor_admit 返回值
+enum {
+    GOV_PROCESS = 0,   // 处理该帧
+    GOV_SKIP    = 1,   // 速率控制, 跳过
+    GOV_DROP    = 2    // 帧已超过截止时间, 丢弃
+};
+
+// 单调时钟 (us), 与 V4L2 MONOTONIC 时间戳同源
+uint64_t governor_now_us(void);
+
+void governor_init(RateGovernor* g, const GovernorConfig* cfg);
+// 根据帧时间戳决定是否处理
+int governor_admit(RateGovernor* g, uint64_t frame_ts_us, uint64_t now_us);
+// 处理完成后回报: 完成时间与本帧检测到的车辆数
+void governor_complete(RateGovernor* g, uint64_t frame_ts_us, uint64_t start_us,
+                       uint64_t done_us, int vehicles);
+// 定期打印统计 (interval_s 秒一次)
+void governor_report(RateGovernor* g, uint64_t now_us, int interval_s);
+
+#endif
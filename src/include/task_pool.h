@@ -0,0 +1,20 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <sched.h>
+
+// 工作窃取任务池: 每个线程有自己的任务队列, 自己的做完后从其他线程队列的另一端窃取.
+// 用于一帧内多辆车的子流水线 (抠图 -> 车牌定位 -> OCR) 并行执行
+typedef struct TaskPool TaskPool;
+
+// 任务函数: index 为任务序号 (0..count-1)
+typedef void (*task_fn)(void* arg, int index);
+
+// workers 为后台线程数; 调用 task_pool_run 的线程也参与执行.
+// cpus 非空时后台线程创建即绑定到该集合, 否则继承创建者的亲和性
+TaskPool* task_pool_create(int workers, const cpu_set_t* cpus);
+// 执行 count 个任务, 全部完成后返回; pool 为 NULL 时在当前线程依次执行
+void task_pool_run(TaskPool* pool, task_fn fn, void* arg, int count);
+void task_pool_destroy(TaskPool* pool);
+
+#endif
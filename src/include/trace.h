@@ -0,0 +1,33 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// 帧级追踪: 触发后记录接下来 N 帧各阶段的耗时区间 (线程、帧号、车辆序号),
+// 导出为 Chrome trace JSON (chrome://tracing 或 ui.perfetto.dev 打开).
+// 每个线程写自己的缓冲区, 无锁; 未触发时每个埋点只有一次原子读
+
+// ORT 会话 profiling 输出, 导出时合并到同一时间线
+typedef struct {
+    char file[256];
+    const char* model;   // 显示名称
+    uint64_t start_ns;   // profiling 起始时间 (CLOCK_REALTIME, ns)
+} TraceOrtProfile;
+
+// 请求记录接下来 frames 帧 (下一次 trace_frame_begin 时开始)
+void trace_request(int frames);
+// 主循环每次迭代开始时调用; 开始新一轮记录时返回 1
+int trace_frame_begin(uint64_t frame_id);
+// 一帧处理完成后调用; 本轮帧数已满时返回 1, 调用方随后 trace_dump
+int trace_frame_end(void);
+// 提前结束本轮记录 (如退出时); 正在记录时返回 1
+int trace_stop(void);
+// 导出本轮记录, 并合并 ORT profiling 文件 (合并后删除); 成功返回 0
+int trace_dump(const char* path, const TraceOrtProfile* ort, int ort_count);
+
+// 埋点: uint64_t t = trace_begin(); ...; trace_end(t, "阶段名", 车辆序号或 -1)
+// name 须为字符串常量 (只保存指针)
+uint64_t trace_begin(void);
+void trace_end(uint64_t start, const char* name, int vehicle);
+
+#endif
@@ -1,14 +1,142 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include "common_types.h" // RoiPolygon
+
 typedef struct {
+    // [Camera] (需重启生效)
     char device[64];
+    int width;
+    int height;
+    int fps;
+    int buffers;             // V4L2 驱动缓冲区数
+    int dmabuf;              // 把驱动缓冲区导出为 DMABUF
+    RoiPolygon roi;          // 车道检测区域 (原始帧坐标, 可热加载)
+
+    // [Models] (需重启生效)
     char vehicle_model[256];
     char plate_model[256];
     char ocr_model[256];
-    float threshold;
+    char ocr_keys[256];
+    char ocr_fast_model[256]; // 分级识别的快速模型 (可选, 如只含号牌字符的小模型)
+    char ocr_fast_keys[256];  // 快速模型的字典, 留空与 ocr_keys 相同
+
+    // [Providers] 各模型的执行提供程序候选链 (需重启生效), 如 "xnnpack,dnnl,cpu"
+    char vehicle_providers[64];
+    char plate_providers[64];
+    char ocr_providers[64];  // 含快速识别模型
+    char xnnpack_options[128]; // 提供程序选项 "键=值,键=值"
+    char dnnl_options[128];
+    char openvino_options[128];
+
+    // [Thresholds]
+    float threshold;         // 车辆检测置信度
+    float plate_threshold;   // DBNet 热力图阈值
+    float ocr_threshold;     // OCR 字符平均置信度低于该值的读数不采用
+    float nms_threshold;     // 车辆框 NMS IoU
+
+    // [System]
+    int processing_interval; // 空闲时处理间隔 (ms)
+    int latency_budget_ms;   // 端到端延迟预算 (ms)
+    int activity_hold_ms;    // 检测到车辆后保持全速的时长 (ms)
+    int max_detection_per_frame;
+    int enable_anti_fraud;
+
+    // [Performance]
+    int intra_op_threads;    // ORT 全局算子内线程数 (0 = 默认, 需重启生效)
+    int inter_op_threads;    // ORT 全局算子间线程数 (0 = 默认, 需重启生效)
+    int allow_spinning;      // ORT 线程池空闲自旋 (需重启生效)
+    int graph_optimization;  // ORT 图优化级别 0-3 (需重启生效)
+    int parallel_execution;  // ORT 并行执行模式 (需重启生效)
+    int vehicle_workers;     // 多辆车并行处理的工作线程数, 0 = 在主循环中依次处理 (需重启生效)
+    int yolo_input_size;     // 车辆检测输入长边 (32 的倍数)
+    int yolo_input_height;   // 车辆检测输入高度, 0 = 按画面宽高比自动取 32 的倍数
+    int det_size;            // 车牌定位输入边长
+    int ocr_input_width;     // OCR 输入宽度 (高度固定 48)
+
+    // [Quality] OCR 前车牌截图质量把关
+    float quality_min_score;      // 低于该得分的截图不做 OCR
+    float quality_improve_margin; // 同一车辆已有读数时, 得分需高出该值才重新识别
+
+    // [Lists] 白名单/黑名单
+    char list_file[256];     // 名单文件 (需重启生效, 文件内容变化自动重新加载)
+    int list_max_edits;      // 模糊匹配允许的编辑距离 (易混字符不计入)
+    int list_allow_max_edits; // 白名单 (放行) 允许的编辑距离, 默认 0: 只有一致或仅易混字符不同才放行
+
+    // [Events] (需重启生效)
+    char event_dir[256];     // 识别记录与车牌截图输出目录
+    int event_queue_size;    // 事件队列容量
+    int event_crop_drop_percent; // 队列占用超过该百分比时丢弃截图, 保留记录
+    int event_jpeg_quality;
+    int event_save_crops;
+    int event_jsonl;
+    int event_binary;
+
+    // [Store] 车牌事件存储 (需重启生效)
+    int store_enable;
+    char store_dir[256];
+    int store_segment_records;
+    int store_merge_records;
+    int store_retention_days;
+
+    // [Affinity] 线程绑核 (需重启生效), CPU 列表格式 "0-3,6", 留空按拓扑自动分配
+    int affinity_enable;
+    char capture_cpus[64];   // 采集 + 预处理主循环
+    char io_cpus[64];        // 写盘、配置监听等后台线程
+    char ort_cpus[64];       // ORT 全局算子内线程池
+    int capture_fifo;        // 主循环使用 SCHED_FIFO 实时调度
+    int capture_priority;
+
+    // [Trace] 帧级追踪 (kill -USR1 <pid> 触发, 可热加载)
+    char trace_dir[256];     // Chrome trace JSON 输出目录
+    int trace_frames;        // 每次触发记录的帧数
+    int trace_ort_profile;   // 同时开启 ORT profiling 并合并到时间线 (切换会话约需数百毫秒)
+
+    // [Cascade] OCR 分级识别 (可热加载)
+    int cascade_enable;
+    int cascade_fast_width;  // 未配置快速模型时, 完整模型以该输入宽度做快速识别
+    float cascade_accept;    // 接受读数的最低单字符置信度 (且须通过号牌规则校验)
+    char cascade_recrop[64]; // 完整模型仍不可信时依次尝试的车牌框扩张倍数 "宽,高 宽,高"
+
+    // [Pipeline] 车牌定位方式 (可热加载)
+    char pipeline_mode[16];  // cascade: 每辆车定位一次; frame: 整帧定位一次再按位置分配给车辆; plate_only: 整帧定位, 不做车辆检测
+    int frame_det_size;      // 整帧定位输入长边 (32 的倍数, 短边按检测区域宽高比)
+
+    // [PowerSave] 空闲省电 (可热加载)
+    int powersave_enable;
+    int powersave_idle_s;    // 持续无车多久后进入省电 (s)
+    int powersave_width;     // 省电时的采集分辨率与帧率
+    int powersave_height;
+    int powersave_fps;
+    int powersave_cell_delta;    // 网格亮度变化门限 (0-255)
+    float powersave_motion_cells; // 变化网格占比门限
+
+    // [Service] 推理服务 (需重启生效)
+    char service_socket[108]; // plate_inferd 的 unix socket; 采集进程留空时在本进程推理
+    int service_slots;       // 客户端共享内存帧槽位数 (采集与推理重叠)
+    int service_max_batch;   // 服务端一批最多合并的帧数
+    int service_batch_wait_ms; // 有帧就绪后等待其他摄像头的时间
+
+    int version;             // 快照版本号, 每次热加载 +1
 } AppConfig;
 
+// 填充默认值
+void config_set_defaults(AppConfig* config);
+// 解析 INI 配置文件 (未出现的键保持原值), 成功返回 0
 int load_config(const char* path, AppConfig* config);
 
-#endif
\ No newline at end of file
+// --- 配置快照 (热加载) ---
+// 发布新快照, 之后的 config_acquire 将拿到它
+int config_publish(const AppConfig* config);
+// 获取当前快照 (只读, 处理一帧期间保持不变), 用完必须 config_release
+const AppConfig* config_acquire();
+void config_release(const AppConfig* config);
+// 监听配置文件变化 (inotify), 变化后解析并原子替换快照
+int config_watch_start(const char* path);
+void config_watch_stop();
+
+// 额外监听一个文件 (如名单文件), 变化后在监听线程中回调; 与配置文件共用监听线程
+typedef void (*file_change_cb)(const char* path);
+int file_watch_add(const char* path, file_change_cb cb);
+
+#endif
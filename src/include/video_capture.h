@@ -1,15 +1,70 @@
 #ifndef VIDEO_CAPTURE_H
 #define VIDEO_CAPTURE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#define CAMERA_MAX_BUFFERS 32
+
+// 驱动缓冲区 (mmap), 可选导出为 DMABUF
+typedef struct {
+    void* start;
+    size_t length;
+    int dmabuf_fd;             // -1: 未导出
+} CameraBuffer;
+
+// 出队的一帧: 在 camera_release 之前缓冲区归调用方持有, 驱动不会覆盖
+typedef struct {
+    int index;                 // 缓冲区序号
+    const unsigned char* data; // YUYV 原始数据
+    size_t bytes;
+    int dmabuf_fd;             // 零拷贝传递给其他进程/设备用, -1 表示未导出
+    uint32_t sequence;         // 驱动帧序号
+    uint64_t timestamp_us;     // 采集时间戳 (CLOCK_MONOTONIC, us)
+} CameraFrame;
+
 typedef struct {
     int fd;
-    int width;
+    int epfd;
+    int width;                 // 当前分辨率 (驱动可能调整请求的分辨率)
     int height;
+    int fps;                   // 驱动确认的帧率, 0 表示未知
     unsigned char* buffer_rgb; // 转换后的RGB缓存
+    size_t rgb_capacity;
+    uint64_t timestamp_us;     // 当前帧的采集时间戳 (CLOCK_MONOTONIC, us)
+    CameraBuffer bufs[CAMERA_MAX_BUFFERS];
+    int buf_count;
+    int buffers_wanted;        // 申请的缓冲区数
+    int export_dmabuf;
+    int dmabuf_exported;       // 全部缓冲区已导出
+    int held;                  // 已出队尚未归还的缓冲区数
+
+    // 统计
+    uint32_t last_sequence;
+    int have_sequence;
+    unsigned long frames;      // 出队的帧数
+    unsigned long dropped;     // 驱动丢帧 (帧序号缺口: 缓冲区全部被占用或总线带宽不足)
+    unsigned long corrupted;   // 驱动标记 V4L2_BUF_FLAG_ERROR 的帧
+    uint64_t last_report;
 } CameraContext;
 
-int camera_init(CameraContext* ctx, const char* device, int w, int h);
+// fps: 请求的帧率 (VIDIOC_S_PARM); buffers: 申请的驱动缓冲区数 (驱动可能调整); export_dmabuf: 把缓冲区导出为 DMABUF
+int camera_init(CameraContext* ctx, const char* device, int w, int h, int fps, int buffers, int export_dmabuf);
+// 运行中切换分辨率与帧率 (停流 -> S_FMT/S_PARM -> 重新申请缓冲区 -> 开流), 通常耗时数十到数百毫秒;
+// 调用时不能持有未归还的帧. 失败时视频流处于停止状态
+int camera_reconfigure(CameraContext* ctx, int w, int h, int fps);
+// 等待并取出下一帧 (非阻塞 fd + epoll); 超时或被信号打断返回 1, 设备出错返回 -1
+int camera_dequeue(CameraContext* ctx, CameraFrame* frame, int timeout_ms);
+// 转码到 rgb (width * height * 3), 如推理服务的共享内存槽位
+void camera_convert(CameraContext* ctx, const CameraFrame* frame, unsigned char* rgb);
+// 归还缓冲区给驱动
+void camera_release(CameraContext* ctx, const CameraFrame* frame);
+// 出队 + 转码到内部缓存 + 归还
 int camera_capture(CameraContext* ctx, unsigned char** frame_data);
+// 出队 + 转码到 rgb + 归还
+int camera_capture_to(CameraContext* ctx, unsigned char* rgb);
+// 定期打印采集统计 (interval_s 秒一次)
+void camera_report(CameraContext* ctx, uint64_t now_us, int interval_s);
 void camera_close(CameraContext* ctx);
 
-#endif
\ No newline at end of file
+#endif
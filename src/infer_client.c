@@ -0,0 +1,196 @@
+// 推理服务客户端: 共享内存槽位环 + eventfd 通知
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include "include/infer_service.h"
+
+struct InferClient {
+    int sock;
+    int memfd;
+    int req_efd;     // 通知服务端有新帧
+    int done_efd;    // 服务端通知处理完成
+    unsigned char* shm;
+    uint64_t shm_size;
+    InferShmHeader* hdr;
+    int width, height;
+    uint64_t submitted;  // 已提交帧数, 下一个写入槽位 = submitted % slots
+    uint64_t collected;  // 已取回帧数
+};
+
+uint64_t infer_shm_layout(int width, int height, int slots, InferShmHeader* hdr) {
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = INFER_MAGIC;
+    hdr->slots = slots;
+    hdr->crops_offset = (sizeof(InferSlot) + 63) & ~63ULL;
+    hdr->crop_max = (uint64_t)(width / 2) * (height / 4) * 3;
+    if (hdr->crop_max < INFER_CROP_MIN) hdr->crop_max = INFER_CROP_MIN;
+    hdr->frame_offset = hdr->crops_offset + (uint64_t)INFER_MAX_RESULTS * hdr->crop_max;
+    hdr->slot_bytes = (hdr->frame_offset + (uint64_t)width * height * 3 + 4095) & ~4095ULL;
+    return 4096 + hdr->slot_bytes * slots;
+}
+
+static InferSlot* slot_at(InferClient* c, uint64_t n) {
+    return (InferSlot*)(c->shm + 4096 + (n % c->hdr->slots) * c->hdr->slot_bytes);
+}
+
+static int send_hello(int sock, const InferHello* hello, const int* fds, int nfds) {
+    struct iovec iov = { (void*)hello, sizeof(*hello) };
+    char ctrl[CMSG_SPACE(3 * sizeof(int))];
+    memset(ctrl, 0, sizeof(ctrl));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+    struct cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+    memcpy(CMSG_DATA(cm), fds, nfds * sizeof(int));
+    return sendmsg(sock, &msg, 0) == (ssize_t)sizeof(*hello) ? 0 : -1;
+}
+
+InferClient* infer_client_connect(const char* socket_path, int width, int height, int slots) {
+    if (slots < 1) slots = 1;
+    if (slots > INFER_MAX_SLOTS) slots = INFER_MAX_SLOTS;
+
+    InferClient* c = calloc(1, sizeof(InferClient));
+    if (!c) return NULL;
+    c->sock = c->memfd = c->req_efd = c->done_efd = -1;
+    c->width = width;
+    c->height = height;
+
+    InferShmHeader layout;
+    c->shm_size = infer_shm_layout(width, height, slots, &layout);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+
+    c->sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c->sock < 0 || connect(c->sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        printf("[Service] 无法连接推理服务 %s: %s\n", socket_path, strerror(errno));
+        goto fail;
+    }
+    c->memfd = memfd_create("plate_frames", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    c->req_efd = eventfd(0, EFD_CLOEXEC);
+    c->done_efd = eventfd(0, EFD_CLOEXEC);
+    // 封住大小: 服务端只接受不能再截断的 memfd, 否则截断会让服务端访问映射时 SIGBUS
+    if (c->memfd < 0 || c->req_efd < 0 || c->done_efd < 0 || ftruncate(c->memfd, c->shm_size) != 0 ||
+        fcntl(c->memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        printf("[Service] 创建共享内存失败: %s\n", strerror(errno));
+        goto fail;
+    }
+    c->shm = mmap(NULL, c->shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, c->memfd, 0);
+    if (c->shm == MAP_FAILED) {
+        c->shm = NULL;
+        goto fail;
+    }
+    c->hdr = (InferShmHeader*)c->shm;
+    *c->hdr = layout;
+
+    InferHello hello = { INFER_MAGIC, INFER_VERSION, sizeof(DetectionResult), width, height, slots, c->shm_size };
+    int fds[3] = { c->memfd, c->req_efd, c->done_efd };
+    int32_t status = -1;
+    if (send_hello(c->sock, &hello, fds, 3) != 0 || recv(c->sock, &status, sizeof(status), MSG_WAITALL) != sizeof(status) ||
+        status != 0) {
+        printf("[Service] 推理服务拒绝连接 (版本或帧尺寸不符)\n");
+        goto fail;
+    }
+    printf("[Service] 已连接推理服务 %s, %d 个槽位, 共享内存 %.1f MB\n", socket_path, slots, c->shm_size / 1048576.0);
+    return c;
+
+fail:
+    infer_client_close(c);
+    return NULL;
+}
+
+unsigned char* infer_client_frame(InferClient* c) {
+    InferSlot* s = slot_at(c, c->submitted);
+    if (__atomic_load_n(&s->state, __ATOMIC_ACQUIRE) != INFER_SLOT_FREE) return NULL;
+    return (unsigned char*)s + c->hdr->frame_offset;
+}
+
+int infer_client_submit(InferClient* c, uint64_t timestamp_us) {
+    InferSlot* s = slot_at(c, c->submitted);
+    if (__atomic_load_n(&s->state, __ATOMIC_ACQUIRE) != INFER_SLOT_FREE) return -1;
+    s->timestamp_us = timestamp_us;
+    s->count = 0;
+    s->status = 0;
+    __atomic_store_n(&s->state, INFER_SLOT_READY, __ATOMIC_RELEASE);
+    c->submitted++;
+    uint64_t one = 1;
+    return write(c->req_efd, &one, sizeof(one)) == sizeof(one) ? 0 : -1;
+}
+
+int infer_client_ready(InferClient* c) {
+    if (c->collected == c->submitted) return 0;
+    InferSlot* s = slot_at(c, c->collected);
+    if (__atomic_load_n(&s->state, __ATOMIC_ACQUIRE) == INFER_SLOT_DONE) return 1;
+    // 服务端退出时 socket 挂断 (或可读到 EOF)
+    struct pollfd pfd = { c->sock, POLLIN, 0 };
+    if (poll(&pfd, 1, 0) > 0 && pfd.revents) return -1;
+    return 0;
+}
+
+int infer_client_wait(InferClient* c, int timeout_ms, DetectionResult** results, int* count, int* vehicle_count) {
+    *results = NULL;
+    *count = 0;
+    if (c->collected == c->submitted) return -1;
+    InferSlot* s = slot_at(c, c->collected);
+
+    while (__atomic_load_n(&s->state, __ATOMIC_ACQUIRE) != INFER_SLOT_DONE) {
+        // 同时监视 socket: 服务端退出时 socket 挂断
+        struct pollfd pfd[2] = { { c->done_efd, POLLIN, 0 }, { c->sock, POLLIN, 0 } };
+        int r = poll(pfd, 2, timeout_ms);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        if (pfd[1].revents) {
+            printf("[Service] 推理服务已断开\n");
+            return -1;
+        }
+        uint64_t v;
+        if (read(c->done_efd, &v, sizeof(v)) < 0 && errno != EAGAIN) return -1;
+    }
+
+    int n = s->count < INFER_MAX_RESULTS ? s->count : INFER_MAX_RESULTS;
+    DetectionResult* out = calloc(n > 0 ? n : 1, sizeof(DetectionResult));
+    const unsigned char* crops = (const unsigned char*)s + c->hdr->crops_offset;
+    for (int i = 0; i < n; i++) {
+        out[i] = s->results[i];
+        out[i].plate_img = NULL;
+        uint32_t bytes = s->crop_bytes[i];
+        if (bytes > 0 && bytes <= c->hdr->crop_max) {
+            out[i].plate_img = malloc(bytes);
+            if (out[i].plate_img) memcpy(out[i].plate_img, crops + (size_t)i * c->hdr->crop_max, bytes);
+        }
+    }
+    if (vehicle_count) *vehicle_count = s->vehicle_count;
+    int status = s->status;
+    __atomic_store_n(&s->state, INFER_SLOT_FREE, __ATOMIC_RELEASE);
+    c->collected++;
+
+    *results = out;
+    *count = n;
+    return status;
+}
+
+void infer_client_close(InferClient* c) {
+    if (!c) return;
+    if (c->shm) munmap(c->shm, c->shm_size);
+    if (c->sock >= 0) close(c->sock);
+    if (c->memfd >= 0) close(c->memfd);
+    if (c->req_efd >= 0) close(c->req_efd);
+    if (c->done_efd >= 0) close(c->done_efd);
+    free(c);
+}
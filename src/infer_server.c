@@ -0,0 +1,294 @@
+// 推理服务端: 接收客户端的共享内存与 eventfd, 跨客户端合批处理
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "include/infer_service.h"
+
+#define MAX_CLIENTS 32
+// epoll 事件数据: 监听 socket 为 LISTEN_TAG, 客户端为 (槽号 << 1) | (1: 挂断, 0: 提交通知)
+#define LISTEN_TAG (~0ULL)
+// 连接后须在该时间内完成握手, 否则断开 (握手不阻塞 epoll 线程)
+#define HANDSHAKE_TIMEOUT_MS 2000
+
+typedef struct {
+    int sock;
+    int memfd, req_efd, done_efd;
+    unsigned char* shm;
+    uint64_t shm_size;
+    InferShmHeader hdr;      // 握手时复制, 之后不再信任共享内存中的布局
+    int width, height;
+    uint64_t served;         // 已处理帧数, 下一个处理的槽位 = served % slots
+    FrameContext* ctx;       // 该路视频的车辆跟踪状态
+    int id;
+    double accepted_ms;      // 连接时间, 握手完成前 shm 为 NULL
+    unsigned long crops_dropped; // 超过截图区大小而未回传的截图
+} ServerClient;
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static ServerClient* g_clients[MAX_CLIENTS];
+static int g_next_id = 1;
+static unsigned long g_failed_batches; // 有帧推理失败的批次
+
+static void close_client(int epfd, ServerClient* c) {
+    printf("[Service] 客户端 #%d 断开\n", c->id);
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->sock, NULL);
+    if (c->req_efd >= 0) epoll_ctl(epfd, EPOLL_CTL_DEL, c->req_efd, NULL);
+    if (c->shm) munmap(c->shm, c->shm_size);
+    close(c->sock);
+    if (c->memfd >= 0) close(c->memfd);
+    if (c->req_efd >= 0) close(c->req_efd);
+    if (c->done_efd >= 0) close(c->done_efd);
+    frame_context_destroy(c->ctx);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (g_clients[i] == c) g_clients[i] = NULL;
+    }
+    free(c);
+}
+
+// 读取握手消息与文件描述符, 校验后映射共享内存; 返回 0 成功, 1 消息尚未到达, -1 失败
+static int handshake(ServerClient* c) {
+    InferHello hello;
+    struct iovec iov = { &hello, sizeof(hello) };
+    char ctrl[CMSG_SPACE(3 * sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+    ssize_t got = recvmsg(c->sock, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 1;
+    if (got != sizeof(hello)) return -1;
+
+    struct cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    if (!cm || cm->cmsg_type != SCM_RIGHTS || cm->cmsg_len != CMSG_LEN(3 * sizeof(int))) return -1;
+    int fds[3];
+    memcpy(fds, CMSG_DATA(cm), sizeof(fds));
+    c->memfd = fds[0];
+    c->req_efd = fds[1];
+    c->done_efd = fds[2];
+
+    if (hello.magic != INFER_MAGIC || hello.version != INFER_VERSION || hello.result_size != sizeof(DetectionResult)) {
+        printf("[Service] 客户端版本不符\n");
+        return -1;
+    }
+    if (hello.width < 16 || hello.height < 16 || hello.width > 7680 || hello.height > 4320 ||
+        hello.slots < 1 || hello.slots > INFER_MAX_SLOTS) return -1;
+
+    c->width = hello.width;
+    c->height = hello.height;
+    c->shm_size = infer_shm_layout(c->width, c->height, hello.slots, &c->hdr);
+    struct stat st;
+    if (c->shm_size != hello.shm_size || fstat(c->memfd, &st) != 0 || (uint64_t)st.st_size < c->shm_size) return -1;
+    // 只接受大小已封住的 memfd: 客户端事后截断会让本进程访问映射时 SIGBUS, 影响所有摄像头
+    int seals = fcntl(c->memfd, F_GET_SEALS);
+    if (seals < 0 || (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW)) {
+        printf("[Service] 客户端 #%d 的共享内存未封住大小, 拒绝\n", c->id);
+        return -1;
+    }
+
+    c->shm = mmap(NULL, c->shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, c->memfd, 0);
+    if (c->shm == MAP_FAILED) {
+        c->shm = NULL;
+        return -1;
+    }
+    c->ctx = frame_context_create();
+    return c->ctx ? 0 : -1;
+}
+
+// 接受连接后只登记 socket, 握手消息到达后在 finish_handshake 中处理, 不阻塞 epoll 线程
+static void accept_client(int epfd, int listen_fd) {
+    int sock = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (sock < 0) return;
+
+    int idx = -1;
+    for (int i = 0; i < MAX_CLIENTS && idx < 0; i++) {
+        if (!g_clients[i]) idx = i;
+    }
+    ServerClient* c = idx >= 0 ? calloc(1, sizeof(ServerClient)) : NULL;
+    if (!c) {
+        close(sock);
+        return;
+    }
+    c->sock = sock;
+    c->memfd = c->req_efd = c->done_efd = -1;
+    c->id = g_next_id++;
+    c->accepted_ms = now_ms();
+    g_clients[idx] = c;
+
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP | EPOLLHUP, .data.u64 = ((uint64_t)idx << 1) | 1 };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &ev);
+}
+
+static void finish_handshake(int epfd, ServerClient* c, int idx) {
+    int ret = handshake(c);
+    if (ret > 0) return;
+    int32_t status = ret == 0 ? 0 : -1;
+    if (send(c->sock, &status, sizeof(status), MSG_NOSIGNAL | MSG_DONTWAIT) != sizeof(status) || status != 0) {
+        close_client(epfd, c);
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = (uint64_t)idx << 1 };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, c->req_efd, &ev);
+    // 握手之后 socket 只用于发现断开
+    struct epoll_event hup = { .events = EPOLLRDHUP | EPOLLHUP, .data.u64 = ((uint64_t)idx << 1) | 1 };
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->sock, &hup);
+    printf("[Service] 客户端 #%d 已连接: %dx%d, %u 个槽位\n", c->id, c->width, c->height, c->hdr.slots);
+}
+
+// 断开超时仍未完成握手的连接
+static void expire_handshakes(int epfd) {
+    double now = now_ms();
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        ServerClient* c = g_clients[i];
+        if (c && !c->shm && now - c->accepted_ms > HANDSHAKE_TIMEOUT_MS) close_client(epfd, c);
+    }
+}
+
+static InferSlot* slot_at(ServerClient* c, uint64_t n) {
+    return (InferSlot*)(c->shm + 4096 + (n % c->hdr.slots) * c->hdr.slot_bytes);
+}
+
+// 把结果写回槽位 (截图复制到截图区), 标记完成并通知客户端
+static void complete(ServerClient* c, InferSlot* s, FrameRequest* req) {
+    unsigned char* crops = (unsigned char*)s + c->hdr.crops_offset;
+    int n = req->count < INFER_MAX_RESULTS ? req->count : INFER_MAX_RESULTS;
+    for (int i = 0; i < n; i++) {
+        DetectionResult* r = &req->results[i];
+        size_t bytes = (size_t)r->plate_img_w * r->plate_img_h * 3;
+        s->results[i] = *r;
+        s->results[i].plate_img = NULL;
+        s->crop_bytes[i] = 0;
+        if (r->plate_img && bytes <= c->hdr.crop_max) {
+            memcpy(crops + (size_t)i * c->hdr.crop_max, r->plate_img, bytes);
+            s->crop_bytes[i] = bytes;
+        } else if (r->plate_img) {
+            if (c->crops_dropped++ % 100 == 0) {
+                printf("[Service] 客户端 #%d 车牌截图 %dx%d 超过截图区 (%llu 字节), 已丢弃 %lu 张\n", c->id,
+                       r->plate_img_w, r->plate_img_h, (unsigned long long)c->hdr.crop_max, c->crops_dropped);
+            }
+        }
+    }
+    s->count = n;
+    s->vehicle_count = req->vehicle_count;
+    s->status = req->status;
+    free_results(req->results, req->count);
+
+    __atomic_store_n(&s->state, INFER_SLOT_DONE, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    if (write(c->done_efd, &one, sizeof(one)) < 0) { /* 客户端已退出, 由挂断事件清理 */ }
+}
+
+// 每个客户端取最早的一个就绪帧组成一批 (同一路视频的帧须按顺序跟踪); 返回本批帧数
+static int run_batch(int max_batch) {
+    FrameRequest reqs[MAX_CLIENTS];
+    ServerClient* owners[MAX_CLIENTS];
+    InferSlot* slots[MAX_CLIENTS];
+    int n = 0;
+    for (int i = 0; i < MAX_CLIENTS && n < max_batch; i++) {
+        ServerClient* c = g_clients[i];
+        if (!c || !c->shm) continue;
+        InferSlot* s = slot_at(c, c->served);
+        if (__atomic_load_n(&s->state, __ATOMIC_ACQUIRE) != INFER_SLOT_READY) continue;
+        memset(&reqs[n], 0, sizeof(FrameRequest));
+        reqs[n].rgb = (unsigned char*)s + c->hdr.frame_offset;
+        reqs[n].width = c->width;
+        reqs[n].height = c->height;
+        reqs[n].timestamp_us = s->timestamp_us;
+        reqs[n].ctx = c->ctx;
+        owners[n] = c;
+        slots[n] = s;
+        n++;
+    }
+    if (n == 0) return 0;
+
+    // 推理失败的帧以 status = -1 回报给对应客户端
+    if (process_frames(reqs, n) != 0 && g_failed_batches++ % 100 == 0) {
+        printf("[Service] 推理失败, 已通知客户端 (累计 %lu 批)\n", g_failed_batches);
+    }
+    for (int i = 0; i < n; i++) {
+        complete(owners[i], slots[i], &reqs[i]);
+        owners[i]->served++;
+    }
+    return n;
+}
+
+int infer_server_run(const char* socket_path, int max_batch, int batch_wait_ms, volatile sig_atomic_t* running) {
+    if (max_batch < 1) max_batch = 1;
+    if (max_batch > MAX_CLIENTS) max_batch = MAX_CLIENTS;
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    unlink(socket_path);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 8) != 0) {
+        printf("[Service] 无法监听 %s: %s\n", socket_path, strerror(errno));
+        if (listen_fd >= 0) close(listen_fd);
+        return -1;
+    }
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event lev = { .events = EPOLLIN, .data.u64 = LISTEN_TAG };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &lev);
+    printf("[Service] 推理服务已启动: %s, 每批最多 %d 帧\n", socket_path, max_batch);
+
+    struct epoll_event events[MAX_CLIENTS * 2 + 1];
+    while (*running) {
+        int ne = epoll_wait(epfd, events, sizeof(events) / sizeof(events[0]), 200);
+        if (ne < 0 && errno != EINTR) break;
+        expire_handshakes(epfd);
+
+        int ready = 0;
+        for (int i = 0; i < ne; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == LISTEN_TAG) {
+                accept_client(epfd, listen_fd);
+                continue;
+            }
+            // 同一轮中先处理的挂断事件可能已关闭该客户端
+            ServerClient* c = g_clients[tag >> 1];
+            if (!c) continue;
+            if (tag & 1) {
+                // 握手前 socket 可读即握手消息到达, 握手后只会是挂断
+                if (!c->shm && !(events[i].events & (EPOLLHUP | EPOLLRDHUP))) finish_handshake(epfd, c, (int)(tag >> 1));
+                else close_client(epfd, c);
+            } else {
+                uint64_t v;
+                if (read(c->req_efd, &v, sizeof(v)) > 0) ready = 1;
+            }
+        }
+        if (!ready) continue;
+
+        // 等一小段时间让其他摄像头的帧赶上同一批
+        if (batch_wait_ms > 0) {
+            struct timespec ts = { batch_wait_ms / 1000, (batch_wait_ms % 1000) * 1000000L };
+            nanosleep(&ts, NULL);
+        }
+        // 处理到没有就绪帧为止 (客户端可能一次提交了多个槽位)
+        while (*running && run_batch(max_batch) > 0) {}
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (g_clients[i]) close_client(epfd, g_clients[i]);
+    }
+    close(epfd);
+    close(listen_fd);
+    unlink(socket_path);
+    return 0;
+}
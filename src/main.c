@@ -1,80 +1,410 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include "include/plate_recognition.h"
 #include "include/video_capture.h"
 #include "include/utils.h"
+#include "include/rate_governor.h"
+#include "include/event_sink.h"
+#include "include/plate_store.h"
+#include "include/plate_list.h"
+#include "include/cpu_affinity.h"
+#include "include/trace.h"
+#include "include/infer_service.h"
+#include "include/power_save.h"
 
 static int g_running = 1;
 void handle_sig(int sig) { (void)sig; g_running = 0; }
 
-int main() {
+// SIGUSR1: 追踪接下来若干帧
+static volatile sig_atomic_t g_trace_signal = 0;
+void handle_trace_sig(int sig) { (void)sig; g_trace_signal = 1; }
+
+// 一轮追踪结束: 换回原 ORT 会话, 合并 profiling 输出并导出
+static void finish_trace(const char* dir, int ort_profile) {
+    TraceOrtProfile ort[4];
+    int n = ort_profile ? system_profiling_end(ort, 4) : 0;
+
+    char path[512], stamp[32];
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &tm);
+    snprintf(path, sizeof(path), "%s/trace_%s.json", dir, stamp);
+    trace_dump(path, ort, n);
+}
+
+static void governor_config_from(const AppConfig* cfg, GovernorConfig* gov_cfg) {
+    gov_cfg->idle_interval_ms = cfg->processing_interval;
+    gov_cfg->latency_budget_ms = cfg->latency_budget_ms;
+    gov_cfg->activity_hold_ms = cfg->activity_hold_ms;
+}
+
+static void power_save_config_from(const AppConfig* cfg, PowerSaveConfig* ps_cfg) {
+    ps_cfg->enable = cfg->powersave_enable;
+    ps_cfg->idle_after_s = cfg->powersave_idle_s;
+    ps_cfg->width = cfg->powersave_width;
+    ps_cfg->height = cfg->powersave_height;
+    ps_cfg->fps = cfg->powersave_fps;
+    ps_cfg->cell_delta = cfg->powersave_cell_delta;
+    ps_cfg->motion_cells = cfg->powersave_motion_cells;
+}
+
+static void on_list_changed(const char* path) {
+    plate_list_load(path);
+}
+
+// --- 推理服务客户端: 最多 slots 帧同时在服务端处理, 采集下一帧与推理重叠 ---
+#define SERVICE_TIMEOUT_US 5000000ULL  // 最早提交的帧超过该时间无结果视为服务卡死, 丢弃并重连
+#define SERVICE_RETRY_US   2000000ULL  // 重连间隔
+
+typedef struct {
+    InferClient* client;       // NULL: 未连接 (等待重连)
+    const AppConfig* cfg;      // 启动配置 (socket、帧尺寸、槽位数需重启生效)
+    uint64_t ts[INFER_MAX_SLOTS];    // 已提交帧的采集时间戳 (按提交顺序)
+    uint64_t start[INFER_MAX_SLOTS]; // 已提交帧的放行时间
+    int head, pending;
+    uint64_t last_connect;
+    unsigned long dropped;     // 槽位用尽或服务断开而丢弃的帧
+    uint64_t last_report;
+} ServiceLink;
+
+// 断开并丢弃在途的帧, 之后由 service_collect 定期重连
+static void service_reset(ServiceLink* link, const char* why) {
+    printf("\n[Service] %s, 丢弃 %d 帧, 稍后重连\n", why, link->pending);
+    link->dropped += link->pending;
+    link->pending = 0;
+    link->head = 0;
+    infer_client_close(link->client);
+    link->client = NULL;
+    link->last_connect = governor_now_us();
+}
+
+// 取回已完成的帧 (不阻塞), 结果交给写盘线程; 返回其中最大的车辆数, 没有完成的帧返回 -1
+static int service_collect(ServiceLink* link, RateGovernor* gov) {
+    uint64_t now = governor_now_us();
+    if (!link->client) {
+        if (now - link->last_connect < SERVICE_RETRY_US) return -1;
+        link->last_connect = now;
+        link->client = infer_client_connect(link->cfg->service_socket, link->cfg->width, link->cfg->height,
+                                            link->cfg->service_slots);
+        return -1;
+    }
+
+    int vehicles = -1;
+    while (link->pending > 0) {
+        int ready = infer_client_ready(link->client);
+        if (ready < 0) {
+            service_reset(link, "推理服务已断开");
+            break;
+        }
+        if (ready == 0) {
+            if (now - link->start[link->head] > SERVICE_TIMEOUT_US) service_reset(link, "推理服务长时间无结果");
+            break;
+        }
+
+        DetectionResult* results = NULL;
+        int count = 0, v = 0;
+        uint64_t ts = link->ts[link->head], start = link->start[link->head];
+        int status = infer_client_wait(link->client, 0, &results, &count, &v);
+        link->head = (link->head + 1) % INFER_MAX_SLOTS;
+        link->pending--;
+        if (status != 0) {
+            // 服务端处理该帧失败: 按丢帧计, 不影响后续帧
+            link->dropped++;
+            free_results(results, count);
+            continue;
+        }
+        governor_complete(gov, ts, start, governor_now_us(), v);
+        // 结果 (连同截图所有权) 交给写盘线程
+        for (int i = 0; i < count; i++) event_sink_post(&results[i]);
+        free_results(results, count);
+        if (v > vehicles) vehicles = v;
+    }
+    return vehicles;
+}
+
+// 提交已转码到槽位的帧
+static void service_submit(ServiceLink* link, uint64_t ts, uint64_t start) {
+    if (infer_client_submit(link->client, ts) != 0) {
+        service_reset(link, "提交帧失败");
+        return;
+    }
+    int tail = (link->head + link->pending) % INFER_MAX_SLOTS;
+    link->ts[tail] = ts;
+    link->start[tail] = start;
+    link->pending++;
+}
+
+static void service_report(ServiceLink* link, uint64_t now, int interval_s) {
+    if (link->last_report == 0) { link->last_report = now; return; }
+    if (now - link->last_report < (uint64_t)interval_s * 1000000ULL) return;
+    link->last_report = now;
+    printf("\n[Service] %s | 在途 %d 帧 | 丢弃 %lu 帧\n", link->client ? "已连接" : "未连接", link->pending, link->dropped);
+}
+
+// 持续无车时切到省电采集 (调用时不能持有摄像头缓冲区); 摄像头无法恢复时返回 -1
+static int power_save_check(PowerSave* ps, CameraContext* cam, const AppConfig* config, int vehicles) {
+    if (!power_save_complete(ps, governor_now_us(), vehicles)) return 0;
+    const AppConfig* snap = config_acquire();
+    RoiPolygon roi = snap->roi;
+    config_release(snap);
+    if (camera_reconfigure(cam, ps->cfg.width, ps->cfg.height, ps->cfg.fps) == 0) {
+        power_save_enter(ps, governor_now_us(), &roi, config->width, config->height);
+        printf("\n[PowerSave] 连续 %d 秒无车, 进入省电: %dx%d @ %dfps\n", ps->cfg.idle_after_s, cam->width, cam->height, cam->fps);
+        return 0;
+    }
+    if (camera_reconfigure(cam, config->width, config->height, config->fps) == 0) {
+        printf("\n[PowerSave] 摄像头不支持省电参数, 保持全速采集\n");
+        ps->last_activity = governor_now_us();
+        return 0;
+    }
+    printf("\n[PowerSave] 无法恢复全速采集, 退出\n");
+    return -1;
+}
+
+int main(int argc, char** argv) {
     signal(SIGINT, handle_sig);
+    signal(SIGUSR1, handle_trace_sig);
 
-    // 加载配置
-    AppConfig config = {
-        .device = "/dev/video0",
-        .vehicle_model = "models/yolov5s.onnx",
-        .plate_model = "models/ppocr_det_v4.onnx",
-        .ocr_model = "models/ppocr_rec_v4.onnx"
-    };
+    // 加载配置 (默认 config/system.conf, 可由第一个参数指定)
+    const char* config_path = argc > 1 ? argv[1] : "config/system.conf";
+    AppConfig config;
+    config_set_defaults(&config);
+    load_config(config_path, &config);
+    config_publish(&config);
 
-    // 初始化 AI 系统
-    if (system_init(&config) != 0) return -1;
+    // 线程放置方案: 采集/预处理主循环、后台线程、各模型 ORT 线程池分开绑核
+    CpuTopology topo;
+    CpuPlacement placement;
+    memset(&placement, 0, sizeof(placement));
+    if (cpu_topology_detect(&topo) == 0) {
+        printf("[Affinity] 可用 CPU %d 个%s%s\n", topo.count, topo.has_smt ? ", 有超线程" : "",
+               topo.big_khz > 0 ? "" : ", 频率未知");
+        cpu_placement_plan(&topo, &config, &placement);
+    }
+    cpu_placement_print(&placement);
+
+    // 初始化 AI 系统; 配置了推理服务时模型由 plate_inferd 持有, 本进程只采集
+    ServiceLink link;
+    memset(&link, 0, sizeof(link));
+    link.cfg = &config;
+    int service = config.service_socket[0] != '\0';
+    if (service) {
+        link.client = infer_client_connect(config.service_socket, config.width, config.height, config.service_slots);
+        if (!link.client) return -1;
+    } else if (system_init(&config, &placement) != 0) {
+        return -1;
+    } else {
+        char providers[128];
+        system_providers(providers, sizeof(providers));
+        printf("[System] 执行提供程序: %s\n", providers);
+    }
 
     // 初始化摄像头
     CameraContext cam;
-    if (camera_init(&cam, config.device, 1280, 720) != 0) {
-        system_cleanup();
+    int cam_ret = camera_init(&cam, config.device, config.width, config.height, config.fps, config.buffers, config.dmabuf);
+    // 客户端模式下帧直接转码到按配置尺寸分配的共享内存槽位, 分辨率必须一致
+    if (cam_ret == 0 && service && (cam.width != config.width || cam.height != config.height)) {
+        printf("[Service] 摄像头实际分辨率与配置不符, 无法使用推理服务\n");
+        cam_ret = -1;
+    }
+    if (cam_ret != 0) {
+        camera_close(&cam);
+        if (service) infer_client_close(link.client);
+        else system_cleanup();
         return -1;
     }
 
+    // 识别结果与车牌截图异步写盘, 处理线程不做 I/O
+    EventSinkConfig sink_cfg = {
+        .queue_size = config.event_queue_size,
+        .crop_drop_percent = config.event_crop_drop_percent,
+        .jpeg_quality = config.event_jpeg_quality,
+        .save_crops = config.event_save_crops,
+        .write_jsonl = config.event_jsonl,
+        .write_binary = config.event_binary,
+        .echo_console = 1
+    };
+    snprintf(sink_cfg.output_dir, sizeof(sink_cfg.output_dir), "%s", config.event_dir);
+
+    // 新线程继承创建者的亲和性: 先切到后台 CPU 再启动写盘/监听线程
+    cpu_pin_current_thread(&placement.io, "后台线程");
+
+    // 车牌事件存储, 由写盘线程追加
+    PlateStore* store = NULL;
+    if (config.store_enable) {
+        PlateStoreConfig store_cfg = {
+            .segment_records = config.store_segment_records,
+            .merge_records = config.store_merge_records,
+            .retention_days = config.store_retention_days
+        };
+        snprintf(store_cfg.dir, sizeof(store_cfg.dir), "%s", config.store_dir);
+        store = plate_store_open(&store_cfg);
+        sink_cfg.store = store;
+    }
+    if (event_sink_start(&sink_cfg) != 0) {
+        printf("[Events] 事件写盘启动失败, 结果将不会保存\n");
+    }
+
+    // 配置文件变化后热加载 (阈值、输入尺寸、处理速率等无需重启)
+    config_watch_start(config_path);
+
+    // 白名单/黑名单: 文件变化后重新加载并原子替换, 识别不中断
+    // (客户端模式下名单匹配在推理服务中进行, 由 plate_inferd 加载)
+    if (!service && access(config.list_file, F_OK) == 0) {
+        plate_list_load(config.list_file);
+        file_watch_add(config.list_file, on_list_changed);
+    }
+
+    // 主循环 (采集 + 预处理 + 推理调用) 绑定到专用 CPU
+    cpu_pin_current_thread(&placement.capture, "主循环");
+    if (config.capture_fifo) cpu_set_fifo(config.capture_priority);
+
+    // 自适应处理速率: 空闲按 processing_interval, 有车全速, 超时帧丢弃
+    GovernorConfig gov_cfg;
+    governor_config_from(&config, &gov_cfg);
+    RateGovernor gov;
+    governor_init(&gov, &gov_cfg);
+    // 空闲省电: 长时间无车时降低采集分辨率与帧率
+    PowerSaveConfig ps_cfg;
+    power_save_config_from(&config, &ps_cfg);
+    PowerSave ps;
+    power_save_init(&ps, &ps_cfg);
+    int config_version = 0;
+    char trace_dir[256] = "";
+    int trace_ort = 0;
+
     printf("========= 停车道闸车牌系统启动 =========\n");
 
     int loop_count = 0;
 
     while (g_running) {
-        
-        unsigned char* frame = NULL;
-        int ret = camera_capture(&cam, &frame);
-        if (ret == 0) {
-            loop_count++ ;
-
-            if (loop_count % 30 == 0) {
-                printf("."); 
-                fflush(stdout);
-            }
+        if (g_trace_signal) {
+            g_trace_signal = 0;
+            const AppConfig* cur = config_acquire();
+            trace_request(cur->trace_frames);
+            config_release(cur);
+        }
+        // 新一轮追踪在帧间开始, 此时没有推理在进行, 可以切换 ORT 会话
+        if (trace_frame_begin(loop_count + 1)) {
+            const AppConfig* cur = config_acquire();
+            snprintf(trace_dir, sizeof(trace_dir), "%s", cur->trace_dir);
+            // 客户端模式下模型在服务进程中, 只记录本进程的阶段
+            trace_ort = cur->trace_ort_profile && !service;
+            config_release(cur);
+            mkdir(trace_dir, 0755);
+            if (trace_ort && system_profiling_begin(trace_dir) != 0) trace_ort = 0;
+        }
 
-            if (loop_count % 5 != 0) {
-                usleep(1000); 
-                continue; 
-            }
+        // 客户端模式: 取回服务端已完成的帧 (此时不持有摄像头缓冲区, 可以切换省电采集)
+        if (service) {
+            int done = service_collect(&link, &gov);
+            if (done >= 0 && power_save_check(&ps, &cam, &config, done) != 0) break;
+        }
 
-            int count = 0;
+        // 等待下一帧 (epoll, 超时后回到循环检查退出与追踪信号)
+        CameraFrame cf;
+        int ret = camera_dequeue(&cam, &cf, 100);
+        if (ret != 0) {
+            if (ret < 0) usleep(10000); // 设备出错, 避免空转
+            continue;
+        }
+        loop_count++ ;
 
-            DetectionResult* results = process_frame(frame, cam.width, cam.height, &count);
-            if (count > 0) {
-                printf(">>> 帧检测: %d 辆车\n", count);
-                for (int i = 0; i < count; i++) {
-                    printf("   [车辆 %d] 车牌: %s | 欺诈: %s\n", 
-                           i, 
-                           results[i].plate_text, 
-                           results[i].is_fraud ? "YES (拦截)" : "NO (放行)");
+        if (loop_count % 30 == 0) {
+            printf("."); 
+            fflush(stdout);
+        }
+
+        // 配置热加载后同步调度参数
+        const AppConfig* cur = config_acquire();
+        if (cur->version != config_version) {
+            config_version = cur->version;
+            governor_config_from(cur, &gov.cfg);
+            power_save_config_from(cur, &ps.cfg);
+        }
+        config_release(cur);
+
+        uint64_t now = governor_now_us();
+        governor_report(&gov, now, 60);
+        camera_report(&cam, now, 60);
+        if (service) service_report(&link, now, 60);
+
+        // 省电中: 不转码、不推理, 只在亮度网格上检查画面变化; 有变化 (或关闭了省电) 立即恢复全速
+        if (ps.idle) {
+            uint64_t tm = trace_begin();
+            int moved = cf.bytes >= (size_t)cam.width * cam.height * 2 && power_save_motion(&ps, cf.data, cam.width, cam.height);
+            trace_end(tm, "capture.motion", -1);
+            camera_release(&cam, &cf);
+            if (moved || !ps.cfg.enable) {
+                if (camera_reconfigure(&cam, config.width, config.height, config.fps) != 0) {
+                    printf("\n[PowerSave] 无法恢复全速采集, 退出\n");
+                    break;
                 }
-            } else {
-                // printf("."); fflush(stdout);
+                power_save_leave(&ps, governor_now_us());
+                // 恢复后的第一帧立即处理
+                gov.last_admit_ts = 0;
+                printf("\n[PowerSave] 画面变化 (%d/%d 网格), 恢复全速采集 %dx%d, 切换用时 %.0f ms, 累计省电 %.1f 小时\n",
+                       ps.changed, ps.cells, cam.width, cam.height, (governor_now_us() - now) / 1000.0, ps.idle_seconds / 3600.0);
             }
+            continue;
+        }
+
+        // 是否处理只看时间戳: 跳过的帧不转码, 缓冲区直接还给驱动
+        if (governor_admit(&gov, cf.timestamp_us, now) != GOV_PROCESS) {
+            camera_release(&cam, &cf);
+            continue;
+        }
 
-            if (results) free(results);
-        } else {
-            // loop_count++ ;
-            usleep(10000); // 10ms
+        // 客户端模式直接转码到共享内存槽位, 不再复制; 槽位都在处理中 (或服务未连接) 时丢弃该帧
+        if (service) {
+            unsigned char* slot = link.client ? infer_client_frame(link.client) : NULL;
+            if (slot) camera_convert(&cam, &cf, slot);
+            else link.dropped++;
+            camera_release(&cam, &cf);
+            if (slot) service_submit(&link, cf.timestamp_us, now);
+            if (trace_frame_end()) finish_trace(trace_dir, trace_ort);
+            continue;
         }
+
+        unsigned char* frame = cam.buffer_rgb;
+        camera_convert(&cam, &cf, frame);
+        camera_release(&cam, &cf);
+
+        int count = 0;
+        uint64_t ts = trace_begin();
+        DetectionResult* results = process_frame(frame, cam.width, cam.height, cf.timestamp_us, &count);
+        int vehicles = last_frame_vehicle_count();
+        trace_end(ts, "frame", -1);
+        governor_complete(&gov, cf.timestamp_us, now, governor_now_us(), vehicles);
+
+        // 结果 (连同截图所有权) 交给写盘线程, 打印也在写盘线程完成
+        for (int i = 0; i < count; i++) {
+            event_sink_post(&results[i]);
+        }
+
+        free_results(results, count);
+
+        // 持续无车: 切到省电采集 (此时没有持有的缓冲区)
+        if (power_save_check(&ps, &cam, &config, vehicles) != 0) break;
+
+        if (trace_frame_end()) finish_trace(trace_dir, trace_ort);
     }
 
+    // 退出时追踪未完成: 导出已记录的部分
+    if (trace_stop()) finish_trace(trace_dir, trace_ort);
+    config_watch_stop();
+    event_sink_stop();
+    plate_store_close(store);
+    plate_list_unload();
     camera_close(&cam);
-    system_cleanup();
+    if (service) infer_client_close(link.client);
+    else system_cleanup();
     printf("\n系统退出。\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -1,81 +1,431 @@
 #include "include/onnx_inference.h"
+#include <onnxruntime_session_options_config_keys.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
 static const OrtApi* g_ort = NULL;
 
-int onnx_model_init(ONNXModel* m, const char* path) {
+// 进程内共享的环境: 三个模型共用一个全局算子内/算子间线程池和一个 CPU arena 分配器
+static OrtEnv* g_env = NULL;
+static OnnxRuntimeOptions g_opts;
+static int g_env_refs = 0;
+
+// 检查 ORT 返回状态, 失败时打印并释放
+static int ort_check(OrtStatus* status, const char* what) {
+    if (status == NULL) return 0;
+    printf("%s 失败: %s\n", what, g_ort->GetErrorMessage(status));
+    g_ort->ReleaseStatus(status);
+    return -1;
+}
+
+void onnx_runtime_default_options(OnnxRuntimeOptions* opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->allow_spinning = 1;
+    opts->graph_optimization = 3;
+}
+
+int onnx_runtime_init(const OnnxRuntimeOptions* opts) {
+    if (g_env) return 0;
     if (!g_ort) g_ort = OrtGetApiBase()->GetApi(ORT_API_VERSION);
-    
-    if (g_ort->CreateEnv(ORT_LOGGING_LEVEL_WARNING, "test", &m->env) != NULL) return -1;
-    if (g_ort->CreateSessionOptions(&m->session_options) != NULL) return -1;
-    if (g_ort->CreateSession(m->env, path, m->session_options, &m->session) != NULL) {
+    if (opts) g_opts = *opts;
+    else onnx_runtime_default_options(&g_opts);
+
+    OrtThreadingOptions* tp = NULL;
+    if (ort_check(g_ort->CreateThreadingOptions(&tp), "创建线程池配置") != 0) return -1;
+
+    int intra_threads = g_opts.intra_op_threads;
+    int ok = 1;
+    if (g_opts.intra_affinity[0]) {
+        // 每个池线程绑定一个 CPU, 线程数由亲和性列表决定 (调用线程自身算第 1 个)
+        intra_threads = 2;
+        for (const char* p = g_opts.intra_affinity; *p; p++) intra_threads += *p == ';';
+        ok = ok && ort_check(g_ort->SetGlobalIntraOpThreadAffinity(tp, g_opts.intra_affinity), "设置算子内线程亲和性") == 0;
+    }
+    if (intra_threads > 0)
+        ok = ok && ort_check(g_ort->SetGlobalIntraOpNumThreads(tp, intra_threads), "设置算子内线程数") == 0;
+    if (g_opts.inter_op_threads > 0)
+        ok = ok && ort_check(g_ort->SetGlobalInterOpNumThreads(tp, g_opts.inter_op_threads), "设置算子间线程数") == 0;
+    ok = ok && ort_check(g_ort->SetGlobalSpinControl(tp, g_opts.allow_spinning), "设置线程池自旋") == 0;
+    ok = ok && ort_check(g_ort->CreateEnvWithGlobalThreadPools(ORT_LOGGING_LEVEL_WARNING, "plate", tp, &g_env),
+                         "创建 ORT 环境") == 0;
+    g_ort->ReleaseThreadingOptions(tp);
+    if (!ok) {
+        if (g_env) g_ort->ReleaseEnv(g_env);
+        g_env = NULL;
+        return -1;
+    }
+
+    // 共享 arena: 各会话的中间张量从同一块内存池分配, 按需增长而非成倍扩张
+    OrtMemoryInfo* mem_info = NULL;
+    OrtArenaCfg* arena = NULL;
+    const char* keys[] = { "arena_extend_strategy" };
+    const size_t values[] = { 1 }; // kSameAsRequested
+    if (ort_check(g_ort->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &mem_info), "创建内存信息") == 0 &&
+        ort_check(g_ort->CreateArenaCfgV2(keys, values, 1, &arena), "创建 arena 配置") == 0 &&
+        ort_check(g_ort->CreateAndRegisterAllocator(g_env, mem_info, arena), "注册共享分配器") == 0) {
+        g_opts.shared_allocator = 1;
+    } else {
+        g_opts.shared_allocator = 0;
+    }
+    if (arena) g_ort->ReleaseArenaCfg(arena);
+    if (mem_info) g_ort->ReleaseMemoryInfo(mem_info);
+
+    printf("[ORT] 全局线程池: 算子内 %d 线程%s, 算子间 %d 线程, 自旋 %s, 图优化级别 %d, %s执行\n",
+           intra_threads, g_opts.intra_affinity[0] ? " (已绑核)" : "", g_opts.inter_op_threads,
+           g_opts.allow_spinning ? "开" : "关", g_opts.graph_optimization,
+           g_opts.parallel_execution ? "并行" : "顺序");
+
+    char** names = NULL;
+    int count = 0;
+    if (ort_check(g_ort->GetAvailableProviders(&names, &count), "查询执行提供程序") == 0) {
+        printf("[ORT] 本运行库包含的执行提供程序:");
+        for (int i = 0; i < count; i++) printf(" %s", names[i]);
+        printf("\n");
+        ort_check(g_ort->ReleaseAvailableProviders(names, count), "释放执行提供程序列表");
+    }
+    return 0;
+}
+
+void onnx_runtime_shutdown(void) {
+    if (g_env && g_env_refs == 0) {
+        g_ort->ReleaseEnv(g_env);
+        g_env = NULL;
+    }
+}
+
+// 可配置的 CPU 执行提供程序: 配置中的名称与 GetAvailableProviders 中的名称
+typedef struct {
+    const char* name;
+    const char* ort_name;
+} ProviderInfo;
+
+static const ProviderInfo PROVIDERS[] = {
+    { "cpu",      "CPUExecutionProvider" },
+    { "xnnpack",  "XnnpackExecutionProvider" },
+    { "dnnl",     "DnnlExecutionProvider" },
+    { "openvino", "OpenVINOExecutionProvider" },
+};
+#define NUM_PROVIDERS ((int)(sizeof(PROVIDERS) / sizeof(PROVIDERS[0])))
+#define MAX_PROVIDER_OPTIONS 16
+
+static const ProviderInfo* find_provider(const char* name) {
+    for (int i = 0; i < NUM_PROVIDERS; i++) {
+        if (strcmp(PROVIDERS[i].name, name) == 0) return &PROVIDERS[i];
+    }
+    return NULL;
+}
+
+// 运行库是否编译了该提供程序 (未编译的直接跳过, 不必尝试注册)
+static int provider_available(const ProviderInfo* p) {
+    char** names = NULL;
+    int count = 0;
+    if (ort_check(g_ort->GetAvailableProviders(&names, &count), "查询执行提供程序") != 0) return 0;
+    int found = 0;
+    for (int i = 0; i < count && !found; i++) found = strcmp(names[i], p->ort_name) == 0;
+    ort_check(g_ort->ReleaseAvailableProviders(names, count), "释放执行提供程序列表");
+    return found;
+}
+
+// "k=v,k=v" 拆成键值数组 (原地修改 buf), 返回项数
+static int parse_provider_options(char* buf, const char** keys, const char** values, int max) {
+    int n = 0;
+    char* save = NULL;
+    for (char* tok = strtok_r(buf, ", \t", &save); tok && n < max; tok = strtok_r(NULL, ", \t", &save)) {
+        char* eq = strchr(tok, '=');
+        if (!eq || eq == tok) continue;
+        *eq = '\0';
+        keys[n] = tok;
+        values[n] = eq + 1;
+        n++;
+    }
+    return n;
+}
+
+// 把执行提供程序注册到会话选项; cpu 为 ORT 默认, 无需注册
+static int append_provider(OrtSessionOptions* so, const char* name) {
+    const char* keys[MAX_PROVIDER_OPTIONS];
+    const char* values[MAX_PROVIDER_OPTIONS];
+    char buf[128];
+    int n;
+
+    if (strcmp(name, "xnnpack") == 0) {
+        snprintf(buf, sizeof(buf), "%s", g_opts.xnnpack_options);
+        n = parse_provider_options(buf, keys, values, MAX_PROVIDER_OPTIONS);
+        return ort_check(g_ort->SessionOptionsAppendExecutionProvider(so, "XNNPACK", keys, values, n),
+                         "注册 XNNPACK");
+    }
+    if (strcmp(name, "dnnl") == 0) {
+        snprintf(buf, sizeof(buf), "%s", g_opts.dnnl_options);
+        n = parse_provider_options(buf, keys, values, MAX_PROVIDER_OPTIONS);
+        OrtDnnlProviderOptions* dnnl = NULL;
+        int ret = -1;
+        if (ort_check(g_ort->CreateDnnlProviderOptions(&dnnl), "创建 oneDNN 配置") == 0 &&
+            (n == 0 || ort_check(g_ort->UpdateDnnlProviderOptions(dnnl, keys, values, n), "设置 oneDNN 配置") == 0) &&
+            ort_check(g_ort->SessionOptionsAppendExecutionProvider_Dnnl(so, dnnl), "注册 oneDNN") == 0) {
+            ret = 0;
+        }
+        if (dnnl) g_ort->ReleaseDnnlProviderOptions(dnnl);
+        return ret;
+    }
+    if (strcmp(name, "openvino") == 0) {
+        snprintf(buf, sizeof(buf), "%s", g_opts.openvino_options);
+        n = parse_provider_options(buf, keys, values, MAX_PROVIDER_OPTIONS - 1);
+        // 本系统只用 CPU 设备
+        int has_device = 0;
+        for (int i = 0; i < n; i++) has_device |= strcmp(keys[i], "device_type") == 0;
+        if (!has_device) {
+            keys[n] = "device_type";
+            values[n] = "CPU";
+            n++;
+        }
+        return ort_check(g_ort->SessionOptionsAppendExecutionProvider_OpenVINO_V2(so, keys, values, n),
+                         "注册 OpenVINO");
+    }
+    return 0;
+}
+
+// 按进程级配置与执行提供程序创建会话选项, 失败返回 NULL
+static OrtSessionOptions* create_session_options(const char* provider) {
+    static const GraphOptimizationLevel levels[] = { ORT_DISABLE_ALL, ORT_ENABLE_BASIC, ORT_ENABLE_EXTENDED, ORT_ENABLE_ALL };
+    int level = g_opts.graph_optimization < 0 ? 0 : g_opts.graph_optimization > 3 ? 3 : g_opts.graph_optimization;
+
+    OrtSessionOptions* so = NULL;
+    if (ort_check(g_ort->CreateSessionOptions(&so), "创建会话配置") != 0) return NULL;
+    // 使用环境的全局线程池与共享分配器, 不再为每个会话创建线程池
+    if (ort_check(g_ort->DisablePerSessionThreads(so), "关闭会话独立线程池") != 0 ||
+        ort_check(g_ort->SetSessionGraphOptimizationLevel(so, levels[level]), "设置图优化级别") != 0 ||
+        ort_check(g_ort->SetSessionExecutionMode(so, g_opts.parallel_execution ? ORT_PARALLEL : ORT_SEQUENTIAL),
+                  "设置执行模式") != 0 ||
+        (g_opts.shared_allocator &&
+         ort_check(g_ort->AddSessionConfigEntry(so, kOrtSessionOptionsConfigUseEnvAllocators, "1"),
+                   "启用共享分配器") != 0) ||
+        append_provider(so, provider) != 0) {
+        g_ort->ReleaseSessionOptions(so);
+        return NULL;
+    }
+    return so;
+}
+
+// 用指定执行提供程序创建会话; 成功时会话与选项存入 m
+static int create_session(ONNXModel* m, const char* path, const char* provider) {
+    OrtSessionOptions* so = create_session_options(provider);
+    if (!so) return -1;
+    if (ort_check(g_ort->CreateSession(g_env, path, so, &m->session), "加载模型") != 0) {
+        g_ort->ReleaseSessionOptions(so);
+        return -1;
+    }
+    m->session_options = so;
+    snprintf(m->provider, sizeof(m->provider), "%s", provider);
+    return 0;
+}
+
+int onnx_model_init(ONNXModel* m, const char* path, const char* providers) {
+    memset(m, 0, sizeof(*m));
+    if (!g_env && onnx_runtime_init(NULL) != 0) return -1;
+
+    // 依次尝试候选链中的执行提供程序, 注册或建会话失败时换下一个, 最后总是退回 cpu
+    char chain[128];
+    snprintf(chain, sizeof(chain), "%s", providers && providers[0] ? providers : "cpu");
+    int tried_cpu = 0;
+    char* save = NULL;
+    for (char* name = strtok_r(chain, ", \t", &save); name && !m->session; name = strtok_r(NULL, ", \t", &save)) {
+        const ProviderInfo* p = find_provider(name);
+        if (!p) {
+            printf("[ORT] 未知的执行提供程序 %s, 跳过\n", name);
+            continue;
+        }
+        if (strcmp(name, "cpu") == 0) tried_cpu = 1;
+        else if (!provider_available(p)) {
+            printf("[ORT] 运行库未包含 %s, 跳过\n", p->ort_name);
+            continue;
+        }
+        if (create_session(m, path, name) != 0 && strcmp(name, "cpu") != 0) {
+            printf("[ORT] %s 使用 %s 失败, 尝试下一个\n", path, name);
+        }
+    }
+    if (!m->session && !tried_cpu) create_session(m, path, "cpu");
+    if (!m->session) {
         printf("无法加载模型: %s\n", path);
         return -1;
     }
+    g_env_refs++;
+    m->path = strdup(path);
+    printf("[ORT] %s: 执行提供程序 %s\n", path, m->provider);
+    if (ort_check(g_ort->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &m->memory_info),
+                  "创建内存信息") != 0) return -1;
     
     OrtAllocator* allocator;
-    g_ort->GetAllocatorWithDefaultOptions(&allocator);
+    if (ort_check(g_ort->GetAllocatorWithDefaultOptions(&allocator), "获取默认分配器") != 0) return -1;
     
     // 输入名称 (简化，只取第1个)
     char* name;
-    g_ort->SessionGetInputName(m->session, 0, allocator, &name);
+    if (ort_check(g_ort->SessionGetInputName(m->session, 0, allocator, &name), "读取模型输入名称") != 0) return -1;
     m->input_names = malloc(sizeof(char*));
     m->input_names[0] = strdup(name);
     allocator->Free(allocator, name);
+
+    // 输入形状: 固定尺寸导出的模型必须按该尺寸输入, 动态轴导出的模型可任意尺寸
+    OrtTypeInfo* type_info = NULL;
+    const OrtTensorTypeAndShapeInfo* tensor_info = NULL;
+    m->input_rank = 0;
+    if (ort_check(g_ort->SessionGetInputTypeInfo(m->session, 0, &type_info), "读取模型输入信息") == 0) {
+        size_t rank = 0;
+        if (ort_check(g_ort->CastTypeInfoToTensorInfo(type_info, &tensor_info), "读取模型输入信息") == 0 &&
+            ort_check(g_ort->GetDimensionsCount(tensor_info, &rank), "读取模型输入维度") == 0 &&
+            rank <= sizeof(m->input_dims) / sizeof(m->input_dims[0]) &&
+            ort_check(g_ort->GetDimensions(tensor_info, m->input_dims, rank), "读取模型输入维度") == 0) {
+            m->input_rank = rank;
+        }
+        // uint8 输入的模型 (scripts/convert_u8_nhwc.py 转换) 为 NHWC 布局, 归一化在图内完成
+        ONNXTensorElementDataType elem = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+        if (tensor_info && ort_check(g_ort->GetTensorElementType(tensor_info, &elem), "读取模型输入类型") == 0) {
+            m->input_u8 = elem == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8;
+        }
+        g_ort->ReleaseTypeInfo(type_info);
+    }
     
     // 输出名称
-    g_ort->SessionGetOutputName(m->session, 0, allocator, &name);
+    if (ort_check(g_ort->SessionGetOutputName(m->session, 0, allocator, &name), "读取模型输出名称") != 0) return -1;
     m->output_names = malloc(sizeof(char*));
     m->output_names[0] = strdup(name);
     allocator->Free(allocator, name);
 
+    if (m->input_u8) printf("[ORT] %s: uint8 NHWC 输入\n", path);
     return 0;
 }
 
-int onnx_model_predict(ONNXModel* m, const float* in_data, const int64_t* in_shape, size_t dim, float** out_data, size_t* out_size) {
-    
-    OrtMemoryInfo* mem_info;
-    g_ort->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &mem_info);
-    
+static int run_model(ONNXModel* m, const void* in_data, size_t elem_size, ONNXTensorElementDataType elem_type,
+                     const int64_t* in_shape, size_t dim, float** out_data, size_t* out_size) {
     size_t in_len = 1; 
     for(size_t i=0; i<dim; i++) in_len *= in_shape[i];
     
     OrtValue* input_tensor = NULL;
     // 使用 CreateTensorWithDataAsOrtValue 避免内部拷贝
-    g_ort->CreateTensorWithDataAsOrtValue(mem_info, (void*)in_data, in_len * sizeof(float), 
-                                          in_shape, dim, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, 
-                                          &input_tensor);
+    if (ort_check(g_ort->CreateTensorWithDataAsOrtValue(m->memory_info, (void*)in_data, in_len * elem_size,
+                                                        in_shape, dim, elem_type, &input_tensor),
+                  "创建输入张量") != 0) return -1;
     
     OrtValue* output_tensor = NULL;
-    g_ort->Run(m->session, NULL, (const char* const*)m->input_names, &input_tensor, 1, 
-               (const char* const*)m->output_names, 1, &output_tensor);
-    
-    float* raw_out;
-    g_ort->GetTensorMutableData(output_tensor, (void**)&raw_out);
-    
-    // 获取大小
-    OrtTensorTypeAndShapeInfo* info;
-    g_ort->GetTensorTypeAndShape(output_tensor, &info);
-    size_t elem_cnt;
-    g_ort->GetTensorShapeElementCount(info, &elem_cnt);
-    *out_size = elem_cnt;
+    OrtSession* session = m->profile_session ? m->profile_session : m->session;
+    OrtStatus* status = g_ort->Run(session, NULL, (const char* const*)m->input_names,
+                                   (const OrtValue* const*)&input_tensor, 1,
+                                   (const char* const*)m->output_names, 1, &output_tensor);
+    // 输入尺寸与模型不符等错误 (例如热加载了错误的输入尺寸)
+    if (ort_check(status, "推理") != 0) {
+        g_ort->ReleaseValue(input_tensor);
+        return -1;
+    }
     
-    *out_data = malloc(elem_cnt * sizeof(float));
-    memcpy(*out_data, raw_out, elem_cnt * sizeof(float));
+    float* raw_out = NULL;
+    OrtTensorTypeAndShapeInfo* info = NULL;
+    size_t elem_cnt = 0;
+    int ret = -1;
+    if (ort_check(g_ort->GetTensorMutableData(output_tensor, (void**)&raw_out), "读取输出张量") == 0 &&
+        // 获取大小
+        ort_check(g_ort->GetTensorTypeAndShape(output_tensor, &info), "读取输出形状") == 0 &&
+        ort_check(g_ort->GetTensorShapeElementCount(info, &elem_cnt), "读取输出形状") == 0) {
+        *out_data = malloc(elem_cnt * sizeof(float));
+        if (*out_data) {
+            memcpy(*out_data, raw_out, elem_cnt * sizeof(float));
+            *out_size = elem_cnt;
+            ret = 0;
+        }
+    }
     g_ort->ReleaseValue(input_tensor);
     g_ort->ReleaseValue(output_tensor);
 
     if (info != NULL) {
-        // g_ort->ReleaseTypeInfo(info);
+        g_ort->ReleaseTensorTypeAndShapeInfo(info);
     }
 
-    g_ort->ReleaseMemoryInfo(mem_info);
-    return 0;
+    return ret;
+}
+
+int onnx_model_predict(ONNXModel* m, const float* in_data, const int64_t* in_shape, size_t dim, float** out_data, size_t* out_size) {
+    return run_model(m, in_data, sizeof(float), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, in_shape, dim, out_data, out_size);
+}
+
+int onnx_model_predict_u8(ONNXModel* m, const uint8_t* in_data, const int64_t* in_shape, size_t dim, float** out_data, size_t* out_size) {
+    return run_model(m, in_data, 1, ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8, in_shape, dim, out_data, out_size);
+}
+
+int onnx_model_run_image(ONNXModel* m, const void* input, int height, int width, float** out_data, size_t* out_size) {
+    return onnx_model_run_batch(m, input, 1, height, width, out_data, out_size);
+}
+
+int onnx_model_run_batch(ONNXModel* m, const void* input, int batch, int height, int width, float** out_data, size_t* out_size) {
+    if (m->input_u8) {
+        int64_t shape[] = { batch, height, width, 3 };
+        return onnx_model_predict_u8(m, (const uint8_t*)input, shape, 4, out_data, out_size);
+    }
+    int64_t shape[] = { batch, 3, height, width };
+    return onnx_model_predict(m, (const float*)input, shape, 4, out_data, out_size);
+}
+
+int onnx_model_dynamic_batch(const ONNXModel* m) {
+    return m->input_rank == 4 && m->input_dims[0] <= 0;
+}
+
+int onnx_model_fixed_hw(const ONNXModel* m, int* height, int* width) {
+    if (m->input_rank != 4) return 0;
+    int64_t h = m->input_u8 ? m->input_dims[1] : m->input_dims[2];
+    int64_t w = m->input_u8 ? m->input_dims[2] : m->input_dims[3];
+    if (h <= 0 || w <= 0) return 0;
+    *height = (int)h;
+    *width = (int)w;
+    return 1;
+}
+
+int onnx_model_profile_begin(ONNXModel* m, const char* prefix) {
+    if (m->profile_session || !m->path) return -1;
+    OrtSessionOptions* so = create_session_options(m->provider);
+    if (!so) return -1;
+    int ret = -1;
+    if (ort_check(g_ort->EnableProfiling(so, prefix), "开启 profiling") == 0 &&
+        ort_check(g_ort->CreateSession(g_env, m->path, so, &m->profile_session), "创建 profiling 会话") == 0) {
+        ret = 0;
+    }
+    g_ort->ReleaseSessionOptions(so);
+    return ret;
+}
+
+int onnx_model_profile_end(ONNXModel* m, char* file, size_t file_size, uint64_t* start_ns) {
+    if (!m->profile_session) return -1;
+    OrtAllocator* allocator;
+    char* name = NULL;
+    int ret = -1;
+    if (ort_check(g_ort->GetAllocatorWithDefaultOptions(&allocator), "获取默认分配器") == 0 &&
+        ort_check(g_ort->SessionGetProfilingStartTimeNs(m->profile_session, start_ns), "读取 profiling 起始时间") == 0 &&
+        ort_check(g_ort->SessionEndProfiling(m->profile_session, allocator, &name), "结束 profiling") == 0) {
+        snprintf(file, file_size, "%s", name);
+        allocator->Free(allocator, name);
+        ret = 0;
+    }
+    g_ort->ReleaseSession(m->profile_session);
+    m->profile_session = NULL;
+    return ret;
 }
 
 void onnx_model_cleanup(ONNXModel* m) {
-    if(m->session) g_ort->ReleaseSession(m->session);
-    if(m->env) g_ort->ReleaseEnv(m->env);
+    if (!g_ort) return;
+    if (m->profile_session) {
+        g_ort->ReleaseSession(m->profile_session);
+        m->profile_session = NULL;
+    }
+    if (m->session) {
+        g_ort->ReleaseSession(m->session);
+        m->session = NULL;
+        // 最后一个会话释放后才释放共享环境 (全局线程池)
+        if (--g_env_refs == 0) onnx_runtime_shutdown();
+    }
+    if (m->session_options) g_ort->ReleaseSessionOptions(m->session_options);
+    if (m->memory_info) g_ort->ReleaseMemoryInfo(m->memory_info);
+    if (m->input_names) { free(m->input_names[0]); free(m->input_names); }
+    if (m->output_names) { free(m->output_names[0]); free(m->output_names); }
+    free(m->path);
+    m->path = NULL;
+    m->session_options = NULL;
+    m->memory_info = NULL;
+    m->input_names = m->output_names = NULL;
 }
\ No newline at end of file
@@ -0,0 +1,566 @@
+// 离线评估工具: 用真实的 process_frame 流水线跑标注数据集, 统计识别准确率与各阶段延迟
+//
+//   ./plate_eval [-c 配置文件] [-l 标注文件] [-o 结果.json] [-w 预热次数] [-s] [-v] <数据集目录>
+//   ./plate_eval -C 基准.json 对比.json [...]     并排比较多次评估结果
+//
+// 标注文件 (默认 <数据集目录>/labels.txt) 每行: "图片文件名 车牌1 车牌2 ...", 无车牌的图片只写文件名,
+// '#' 开头为注释. 图片支持 JPEG 与 PPM (P6); 录像请先抽帧 (如 ffmpeg -i a.mp4 frames/%05d.jpg)
+// 并按顺序写入标注文件, 配合 -s 保留帧间的车辆跟踪 (跳过 OCR 的帧按该车已有的最佳读数计分)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#ifndef NO_JPEG
+#include <setjmp.h>
+#include <jpeglib.h>
+#endif
+#include "include/plate_recognition.h"
+#include "include/utils.h"
+
+#define MAX_LABELS 8
+#define MAX_PLATE_CHARS 16
+
+enum { ST_TOTAL = 0, ST_VEHICLE_PRE, ST_VEHICLE_INFER, ST_PLATE_FRAME, ST_VEHICLES, ST_PLATE, ST_OCR, ST_COUNT };
+static const char* STAGE_KEYS[ST_COUNT] = {
+    "total", "vehicle_pre", "vehicle_infer", "plate_frame", "vehicles", "plate", "ocr"
+};
+static const char* STAGE_NAMES[ST_COUNT] = {
+    "整帧", "车辆检测预处理", "车辆检测推理", "整帧车牌定位", "车辆子流水线", "车牌定位 (合计)", "OCR (合计)"
+};
+
+typedef struct {
+    int images;
+    int labels, label_chars;
+    int predictions;
+    int exact, wrong, missed, false_positives;
+    int correct_chars;
+    int ocr_runs[3];         // 分级识别各级推理次数: 快速, 完整, 重新抠图
+    double* stage[ST_COUNT]; // 每张图片一项
+    int timed;
+} EvalStats;
+
+// --- 图片读取 ---
+
+static unsigned char* load_ppm(FILE* f, int* w, int* h) {
+    int maxval;
+    if (fscanf(f, "P6 %d %d %d", w, h, &maxval) != 3 || maxval != 255 || *w <= 0 || *h <= 0) return NULL;
+    fgetc(f);
+    size_t size = (size_t)*w * *h * 3;
+    unsigned char* rgb = malloc(size);
+    if (rgb && fread(rgb, 1, size, f) != size) {
+        free(rgb);
+        return NULL;
+    }
+    return rgb;
+}
+
+#ifndef NO_JPEG
+// libjpeg 默认的错误处理会 exit(): 改为跳回 load_jpeg, 损坏的图片只跳过这一张
+typedef struct {
+    struct jpeg_error_mgr mgr;
+    jmp_buf jump;
+} JpegError;
+
+static void jpeg_error_exit(j_common_ptr cinfo) {
+    longjmp(((JpegError*)cinfo->err)->jump, 1);
+}
+
+static unsigned char* load_jpeg(FILE* f, int* w, int* h) {
+    struct jpeg_decompress_struct cinfo;
+    JpegError jerr;
+    unsigned char* volatile rgb = NULL; // longjmp 之后仍要释放
+    cinfo.err = jpeg_std_error(&jerr.mgr);
+    jerr.mgr.error_exit = jpeg_error_exit;
+    if (setjmp(jerr.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        free(rgb);
+        return NULL;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, f);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+
+    *w = cinfo.output_width;
+    *h = cinfo.output_height;
+    rgb = malloc((size_t)*w * *h * 3);
+    while (rgb && cinfo.output_scanline < cinfo.output_height) {
+        unsigned char* row = rgb + (size_t)cinfo.output_scanline * *w * 3;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return rgb;
+}
+#endif
+
+static unsigned char* load_image(const char* path, int* w, int* h) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    unsigned char magic[2] = {0};
+    if (fread(magic, 1, 2, f) != 2) magic[0] = 0;
+    rewind(f);
+
+    unsigned char* rgb = NULL;
+    if (magic[0] == 'P' && magic[1] == '6') rgb = load_ppm(f, w, h);
+#ifndef NO_JPEG
+    else if (magic[0] == 0xFF && magic[1] == 0xD8) rgb = load_jpeg(f, w, h);
+#endif
+    fclose(f);
+    return rgb;
+}
+
+// --- 车牌比对 ---
+
+// 按 UTF-8 字符拆分, 每个字符打包成一个整数
+static int split_chars(const char* s, uint32_t* out, int max) {
+    int n = 0;
+    while (*s && n < max) {
+        unsigned char c = (unsigned char)*s;
+        int len = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        uint32_t v = 0;
+        int k = 0;
+        for (; k < len && s[k]; k++) v = v << 8 | (unsigned char)s[k];
+        out[n++] = v;
+        s += k;
+    }
+    return n;
+}
+
+static int edit_distance(const uint32_t* a, int na, const uint32_t* b, int nb) {
+    int prev[MAX_PLATE_CHARS + 1], cur[MAX_PLATE_CHARS + 1];
+    for (int j = 0; j <= nb; j++) prev[j] = j;
+    for (int i = 1; i <= na; i++) {
+        cur[0] = i;
+        for (int j = 1; j <= nb; j++) {
+            int d = prev[j - 1] + (a[i - 1] != b[j - 1]);
+            if (prev[j] + 1 < d) d = prev[j] + 1;
+            if (cur[j - 1] + 1 < d) d = cur[j - 1] + 1;
+            cur[j] = d;
+        }
+        memcpy(prev, cur, sizeof(int) * (nb + 1));
+    }
+    return prev[nb];
+}
+
+// 每个标注依次取编辑距离最小的未配对识别结果; 错字超过一半视为漏检 + 误检
+static void score_image(const char* file, char labels[][64], int nlabels,
+                        const DetectionResult* res, int nres, int verbose, EvalStats* st) {
+    int used[64] = {0};
+    if (nres > 64) nres = 64;
+    st->labels += nlabels;
+    st->predictions += nres;
+
+    for (int j = 0; j < nlabels; j++) {
+        uint32_t lc[MAX_PLATE_CHARS], pc[MAX_PLATE_CHARS];
+        int nl = split_chars(labels[j], lc, MAX_PLATE_CHARS);
+        st->label_chars += nl;
+
+        int best = -1, best_d = nl / 2 + 1;
+        for (int i = 0; i < nres; i++) {
+            if (used[i]) continue;
+            int np = split_chars(res[i].plate_text, pc, MAX_PLATE_CHARS);
+            int d = edit_distance(lc, nl, pc, np);
+            if (d < best_d) { best_d = d; best = i; }
+        }
+        if (best < 0) {
+            st->missed++;
+            if (verbose) printf("  %s: 漏检 %s\n", file, labels[j]);
+            continue;
+        }
+        used[best] = 1;
+        st->correct_chars += nl - best_d;
+        if (best_d == 0) {
+            st->exact++;
+        } else {
+            st->wrong++;
+            if (verbose) printf("  %s: 误识 %s -> %s\n", file, labels[j], res[best].plate_text);
+        }
+    }
+    for (int i = 0; i < nres; i++) {
+        if (used[i]) continue;
+        st->false_positives++;
+        if (verbose) printf("  %s: 误检 %s\n", file, res[i].plate_text);
+    }
+}
+
+// -s 模式下本帧的计分结果: 识别结果加上跟踪中车辆的最佳读数.
+// 同一辆车画质没有提升的后续帧会跳过 OCR, 按车 (轨迹) 计分, 否则这些帧都会记为漏检
+static int track_scored_results(const DetectionResult* res, int nres, DetectionResult* out, int max) {
+    char readings[64][64];
+    int nread = last_frame_track_readings(readings, 64);
+    int used[64] = {0};
+    int n = 0;
+    for (int i = 0; i < nres && n < max; i++) {
+        out[n++] = res[i];
+        // 本帧刚识别出的车辆已在结果中, 不重复计入它的轨迹读数
+        for (int k = 0; k < nread; k++) {
+            if (!used[k] && strcmp(readings[k], res[i].plate_text) == 0) { used[k] = 1; break; }
+        }
+    }
+    for (int k = 0; k < nread && n < max; k++) {
+        if (used[k]) continue;
+        memset(&out[n], 0, sizeof(out[n]));
+        memcpy(out[n].plate_text, readings[k], sizeof(out[n].plate_text));
+        n++;
+    }
+    return n;
+}
+
+// --- 统计输出 ---
+
+typedef struct {
+    double mean, p50, p90, p99, max;
+} LatencySummary;
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double* sorted, int n, double p) {
+    int k = (int)(p * n + 0.999999) - 1; // 最近秩
+    if (k < 0) k = 0;
+    if (k >= n) k = n - 1;
+    return sorted[k];
+}
+
+static void summarize(double* v, int n, LatencySummary* s) {
+    memset(s, 0, sizeof(*s));
+    if (n == 0) return;
+    qsort(v, n, sizeof(double), cmp_double);
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += v[i];
+    s->mean = sum / n;
+    s->p50 = percentile(v, n, 0.50);
+    s->p90 = percentile(v, n, 0.90);
+    s->p99 = percentile(v, n, 0.99);
+    s->max = v[n - 1];
+}
+
+static double ratio(int a, int b) {
+    return b > 0 ? (double)a / b : 0.0;
+}
+
+static void json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static int write_json(const char* path, const char* dataset, const char* config_path,
+                      const AppConfig* cfg, const EvalStats* st, const LatencySummary* lat) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        printf("无法写入 %s\n", path);
+        return -1;
+    }
+    fprintf(f, "{\n  \"dataset\": ");
+    json_string(f, dataset);
+    fprintf(f, ",\n  \"config\": ");
+    json_string(f, config_path);
+    fprintf(f, ",\n  \"images\": %d,\n  \"labels\": %d,\n  \"predictions\": %d,\n", st->images, st->labels, st->predictions);
+    fprintf(f, "  \"exact\": %d,\n  \"wrong\": %d,\n  \"missed\": %d,\n  \"false_positives\": %d,\n",
+            st->exact, st->wrong, st->missed, st->false_positives);
+    fprintf(f, "  \"exact_match\": %.4f,\n  \"char_accuracy\": %.4f,\n  \"miss_rate\": %.4f,\n  \"false_positive_rate\": %.4f,\n",
+            ratio(st->exact, st->labels), ratio(st->correct_chars, st->label_chars),
+            ratio(st->missed, st->labels), ratio(st->false_positives, st->predictions));
+    fprintf(f, "  \"ocr_runs\": {\"fast\": %d, \"full\": %d, \"recrop\": %d},\n",
+            st->ocr_runs[0], st->ocr_runs[1], st->ocr_runs[2]);
+    fprintf(f, "  \"latency_ms\": {\n");
+    for (int s = 0; s < ST_COUNT; s++) {
+        fprintf(f, "    \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+                STAGE_KEYS[s], lat[s].mean, lat[s].p50, lat[s].p90, lat[s].p99, lat[s].max,
+                s + 1 < ST_COUNT ? "," : "");
+    }
+    fprintf(f, "  },\n  \"settings\": {\n    \"vehicle_model\": ");
+    json_string(f, cfg->vehicle_model);
+    fprintf(f, ",\n    \"plate_model\": ");
+    json_string(f, cfg->plate_model);
+    fprintf(f, ",\n    \"ocr_model\": ");
+    json_string(f, cfg->ocr_model);
+    char providers[128];
+    system_providers(providers, sizeof(providers));
+    fprintf(f, ",\n    \"providers\": ");
+    json_string(f, providers);
+    fprintf(f, ",\n    \"ocr_fast_model\": ");
+    json_string(f, cfg->ocr_fast_model);
+    fprintf(f, ",\n    \"cascade\": %d,\n    \"cascade_fast_width\": %d,\n    \"cascade_accept\": %.3f,\n    \"cascade_recrop\": ",
+            cfg->cascade_enable, cfg->cascade_fast_width, cfg->cascade_accept);
+    json_string(f, cfg->cascade_recrop);
+    fprintf(f, ",\n    \"pipeline_mode\": ");
+    json_string(f, cfg->pipeline_mode);
+    fprintf(f, ",\n    \"frame_det_size\": %d", cfg->frame_det_size);
+    fprintf(f, ",\n    \"yolo_input_size\": %d,\n    \"yolo_input_height\": %d,\n    \"det_size\": %d,\n    \"ocr_input_width\": %d,\n",
+            cfg->yolo_input_size, cfg->yolo_input_height, cfg->det_size, cfg->ocr_input_width);
+    fprintf(f, "    \"threshold\": %.3f,\n    \"plate_threshold\": %.3f,\n    \"ocr_threshold\": %.3f,\n    \"quality_min_score\": %.3f,\n",
+            cfg->threshold, cfg->plate_threshold, cfg->ocr_threshold, cfg->quality_min_score);
+    fprintf(f, "    \"intra_op_threads\": %d,\n    \"vehicle_workers\": %d\n  }\n}\n",
+            cfg->intra_op_threads, cfg->vehicle_workers);
+    fclose(f);
+    return 0;
+}
+
+static void print_report(const EvalStats* st, const LatencySummary* lat) {
+    printf("\n图片 %d 张, 标注车牌 %d 个, 识别输出 %d 个\n", st->images, st->labels, st->predictions);
+    printf("  完全正确   %6d  (%.2f%%)\n", st->exact, 100.0 * ratio(st->exact, st->labels));
+    printf("  识别错误   %6d\n", st->wrong);
+    printf("  漏检       %6d  (%.2f%%)\n", st->missed, 100.0 * ratio(st->missed, st->labels));
+    printf("  误检       %6d  (占输出 %.2f%%)\n", st->false_positives, 100.0 * ratio(st->false_positives, st->predictions));
+    printf("  字符准确率         %.2f%%\n", 100.0 * ratio(st->correct_chars, st->label_chars));
+    printf("  OCR 推理次数       快速 %d, 完整 %d, 重新抠图 %d\n", st->ocr_runs[0], st->ocr_runs[1], st->ocr_runs[2]);
+
+    printf("\n%-14s %9s %9s %9s %9s %9s  (ms)\n", "", "mean", "p50", "p90", "p99", "max");
+    for (int s = 0; s < ST_COUNT; s++) {
+        printf("%-14s %9.2f %9.2f %9.2f %9.2f %9.2f  %s\n", STAGE_KEYS[s],
+               lat[s].mean, lat[s].p50, lat[s].p90, lat[s].p99, lat[s].max, STAGE_NAMES[s]);
+    }
+}
+
+// --- 对比模式 ---
+
+// 按键路径依次查找 (本工具输出的 JSON 中键名唯一), 取最后一个键的数值
+static int json_number(const char* text, const char* const* path, int depth, double* out) {
+    const char* p = text;
+    char key[64];
+    for (int i = 0; i < depth; i++) {
+        snprintf(key, sizeof(key), "\"%s\"", path[i]);
+        p = strstr(p, key);
+        if (!p) return -1;
+        p += strlen(key);
+    }
+    while (*p == ' ' || *p == ':') p++;
+    char* end;
+    *out = strtod(p, &end);
+    return end == p ? -1 : 0;
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    char* buf = malloc(size + 1);
+    if (buf) {
+        size_t n = fread(buf, 1, size, f);
+        buf[n] = '\0';
+    }
+    fclose(f);
+    return buf;
+}
+
+static int compare_runs(int n, char** files) {
+    char** texts = calloc(n, sizeof(char*));
+    for (int i = 0; i < n; i++) {
+        texts[i] = read_file(files[i]);
+        if (!texts[i]) {
+            printf("无法读取 %s\n", files[i]);
+            for (int k = 0; k < i; k++) free(texts[k]);
+            free(texts);
+            return 1;
+        }
+    }
+
+    printf("%-28s", "");
+    for (int i = 0; i < n; i++) {
+        const char* base = strrchr(files[i], '/');
+        printf(" %18.18s", base ? base + 1 : files[i]);
+    }
+    printf("\n");
+
+    // 准确率类指标 (比例) 与延迟 (ms); 后续各列附带相对第一列的变化
+    static const char* METRICS[] = { "exact_match", "char_accuracy", "miss_rate", "false_positive_rate" };
+    for (size_t m = 0; m < sizeof(METRICS) / sizeof(METRICS[0]); m++) {
+        printf("%-28s", METRICS[m]);
+        double base = 0;
+        for (int i = 0; i < n; i++) {
+            double v = 0;
+            json_number(texts[i], &METRICS[m], 1, &v);
+            if (i == 0) { base = v; printf(" %17.2f%%", 100 * v); }
+            else printf(" %9.2f%% (%+.2f)", 100 * v, 100 * (v - base));
+        }
+        printf("\n");
+    }
+    static const char* STATS[] = { "p50", "p99" };
+    for (int s = 0; s < ST_COUNT; s++) {
+        for (int k = 0; k < 2; k++) {
+            const char* path[] = { "latency_ms", STAGE_KEYS[s], STATS[k] };
+            char name[64];
+            snprintf(name, sizeof(name), "%s %s ms", STAGE_KEYS[s], STATS[k]);
+            printf("%-28s", name);
+            double base = 0;
+            for (int i = 0; i < n; i++) {
+                double v = 0;
+                json_number(texts[i], path, 3, &v);
+                if (i == 0) { base = v; printf(" %18.2f", v); }
+                else printf(" %9.2f (%+5.0f%%)", v, base > 0 ? 100 * (v - base) / base : 0.0);
+            }
+            printf("\n");
+        }
+    }
+    static const char* SETTINGS[] = { "yolo_input_size", "det_size", "frame_det_size", "ocr_input_width", "threshold", "vehicle_workers" };
+    for (size_t k = 0; k < sizeof(SETTINGS) / sizeof(SETTINGS[0]); k++) {
+        const char* path[] = { "settings", SETTINGS[k] };
+        printf("%-28s", SETTINGS[k]);
+        for (int i = 0; i < n; i++) {
+            double v = 0;
+            json_number(texts[i], path, 2, &v);
+            printf(" %18g", v);
+        }
+        printf("\n");
+    }
+
+    for (int i = 0; i < n; i++) free(texts[i]);
+    free(texts);
+    return 0;
+}
+
+// --- 评估 ---
+
+static void usage(const char* prog) {
+    printf("用法: %s [-c 配置文件] [-l 标注文件] [-o 结果.json] [-w 预热次数] [-s] [-v] <数据集目录>\n", prog);
+    printf("      %s -C 基准.json 对比.json [...]\n", prog);
+    printf("  -s  按标注文件顺序作为连续帧处理 (保留车辆跟踪, 按车计分), 默认每张图片独立\n");
+    printf("  -v  打印每个识别错误/漏检/误检\n");
+}
+
+int main(int argc, char** argv) {
+    const char* config_path = "config/system.conf";
+    const char* label_path = NULL;
+    const char* json_path = NULL;
+    int warmup = 1, sequence = 0, verbose = 0, compare = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:l:o:w:svC")) != -1) {
+        if (opt == 'c') config_path = optarg;
+        else if (opt == 'l') label_path = optarg;
+        else if (opt == 'o') json_path = optarg;
+        else if (opt == 'w') warmup = atoi(optarg);
+        else if (opt == 's') sequence = 1;
+        else if (opt == 'v') verbose = 1;
+        else if (opt == 'C') compare = 1;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (compare) {
+        if (argc - optind < 2) {
+            usage(argv[0]);
+            return 1;
+        }
+        return compare_runs(argc - optind, argv + optind);
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char* dataset = argv[optind];
+    char default_labels[512];
+    if (!label_path) {
+        snprintf(default_labels, sizeof(default_labels), "%s/labels.txt", dataset);
+        label_path = default_labels;
+    }
+    FILE* lf = fopen(label_path, "r");
+    if (!lf) {
+        printf("无法打开标注文件 %s\n", label_path);
+        return 1;
+    }
+
+    AppConfig config;
+    config_set_defaults(&config);
+    load_config(config_path, &config);
+    config_publish(&config);
+    // 不绑核, 不启动写盘/名单: 只测识别流水线本身
+    if (system_init(&config, NULL) != 0) {
+        fclose(lf);
+        return 1;
+    }
+
+    EvalStats st;
+    memset(&st, 0, sizeof(st));
+    int cap = 1024;
+    for (int s = 0; s < ST_COUNT; s++) st.stage[s] = malloc(cap * sizeof(double));
+
+    char line[1024];
+    while (fgets(line, sizeof(line), lf)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* save = NULL;
+        char* file = strtok_r(line, " \t", &save);
+        if (!file || file[0] == '#') continue;
+        char labels[MAX_LABELS][64];
+        int nlabels = 0;
+        char* tok;
+        while ((tok = strtok_r(NULL, " \t", &save)) && nlabels < MAX_LABELS) {
+            snprintf(labels[nlabels++], sizeof(labels[0]), "%s", tok);
+        }
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dataset, file);
+        int w, h;
+        unsigned char* rgb = load_image(path, &w, &h);
+        if (!rgb) {
+            printf("跳过无法读取的图片 %s\n", path);
+            continue;
+        }
+
+        // 首次推理包含内存分配与内核选择, 不计入统计
+        for (; warmup > 0; warmup--) {
+            int n = 0;
+            free_results(process_frame(rgb, w, h, 0, &n), n);
+            reset_vehicle_tracks();
+        }
+
+        if (!sequence) reset_vehicle_tracks();
+        int count = 0;
+        DetectionResult* res = process_frame(rgb, w, h, 0, &count);
+        FrameTiming t;
+        last_frame_timing(&t);
+
+        if (st.timed == cap) {
+            cap *= 2;
+            for (int s = 0; s < ST_COUNT; s++) st.stage[s] = realloc(st.stage[s], cap * sizeof(double));
+        }
+        st.stage[ST_TOTAL][st.timed] = t.total_ms;
+        st.stage[ST_VEHICLE_PRE][st.timed] = t.vehicle_pre_ms;
+        st.stage[ST_VEHICLE_INFER][st.timed] = t.vehicle_infer_ms;
+        st.stage[ST_PLATE_FRAME][st.timed] = t.plate_frame_ms;
+        st.stage[ST_VEHICLES][st.timed] = t.vehicles_ms;
+        st.stage[ST_PLATE][st.timed] = t.plate_ms;
+        st.stage[ST_OCR][st.timed] = t.ocr_ms;
+        for (int k = 0; k < 3; k++) st.ocr_runs[k] += t.ocr_runs[k];
+        st.timed++;
+        st.images++;
+
+        if (sequence) {
+            DetectionResult scored[64];
+            int nscored = track_scored_results(res, count, scored, 64);
+            score_image(file, labels, nlabels, scored, nscored, verbose, &st);
+        } else {
+            score_image(file, labels, nlabels, res, count, verbose, &st);
+        }
+        free_results(res, count);
+        free(rgb);
+
+        if (st.images % 50 == 0) {
+            printf(".");
+            fflush(stdout);
+        }
+    }
+    fclose(lf);
+
+    LatencySummary lat[ST_COUNT];
+    for (int s = 0; s < ST_COUNT; s++) summarize(st.stage[s], st.timed, &lat[s]);
+    print_report(&st, lat);
+    int ret = 0;
+    if (json_path && write_json(json_path, dataset, config_path, &config, &st, lat) != 0) ret = 1;
+
+    for (int s = 0; s < ST_COUNT; s++) free(st.stage[s]);
+    system_cleanup();
+    return ret;
+}
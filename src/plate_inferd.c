@@ -0,0 +1,64 @@
+// 推理服务守护进程: 持有全部模型, 为多个采集进程 (每路摄像头一个) 合批推理
+//
+// 用法: plate_inferd [配置文件]
+// 各采集进程的配置中 [Service] socket 指向同一路径即以客户端模式运行
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include "include/plate_recognition.h"
+#include "include/utils.h"
+#include "include/cpu_affinity.h"
+#include "include/infer_service.h"
+#include "include/plate_list.h"
+
+static volatile sig_atomic_t g_running = 1;
+static void handle_sig(int sig) { (void)sig; g_running = 0; }
+
+static void on_list_changed(const char* path) {
+    plate_list_load(path);
+}
+
+int main(int argc, char** argv) {
+    signal(SIGINT, handle_sig);
+    signal(SIGTERM, handle_sig);
+
+    const char* config_path = argc > 1 ? argv[1] : "config/system.conf";
+    AppConfig config;
+    config_set_defaults(&config);
+    load_config(config_path, &config);
+    config_publish(&config);
+    if (config.service_socket[0] == '\0') {
+        printf("[Service] 配置中 [Service] socket 为空\n");
+        return -1;
+    }
+
+    // 服务端没有采集线程: 主线程只做 epoll 与前处理, ORT 线程池按拓扑放置
+    CpuTopology topo;
+    CpuPlacement placement;
+    memset(&placement, 0, sizeof(placement));
+    if (cpu_topology_detect(&topo) == 0) cpu_placement_plan(&topo, &config, &placement);
+    cpu_placement_print(&placement);
+
+    if (system_init(&config, &placement) != 0) return -1;
+    char providers[128];
+    system_providers(providers, sizeof(providers));
+    printf("[System] 执行提供程序: %s\n", providers);
+
+    // 阈值等可热加载的参数对各路客户端同时生效
+    config_watch_start(config_path);
+
+    // 白名单/黑名单匹配在服务端进行: 名单文件变化后重新加载并原子替换
+    if (access(config.list_file, F_OK) == 0) {
+        plate_list_load(config.list_file);
+        file_watch_add(config.list_file, on_list_changed);
+    }
+
+    int ret = infer_server_run(config.service_socket, config.service_max_batch, config.service_batch_wait_ms, &g_running);
+
+    config_watch_stop();
+    plate_list_unload();
+    system_cleanup();
+    printf("推理服务退出。\n");
+    return ret;
+}
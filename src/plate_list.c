@@ -0,0 +1,420 @@
+// 白名单/黑名单匹配 (排序数组 + 隐式字典树上的有界编辑距离搜索)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "include/plate_list.h"
+
+#define KEY_SIZE 16
+#define MAX_CHARS KEY_SIZE
+#define LIST_MAGIC 0x534C4C50u  // "PLLS"
+#define LIST_VERSION 1
+
+// 名单项, 按 (canon, plate) 升序
+typedef struct {
+    char canon[KEY_SIZE];   // 易混字符归并后的键
+    char plate[KEY_SIZE];   // 归一化车牌
+    int32_t type;
+    int32_t reserved;
+} ListEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+    int64_t src_mtime;      // 源文件修改时间 (ns) 与大小, 用于判断 .idx 是否过期
+    int64_t src_size;
+} ListHeader;
+
+typedef struct {
+    void* map;              // mmap 的 .idx
+    size_t map_len;
+    ListEntry* heap;        // .idx 无法写入时的内存副本
+    const ListEntry* e;
+    uint32_t n;
+    int refs;
+} PlateList;
+
+static pthread_mutex_t g_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static PlateList* g_list = NULL;
+
+// 易混字符归为同一类: 识别时常见 O/0/D/Q, I/1, 8/B, 2/Z, 5/S, 6/G
+static char confusion_class(char c) {
+    switch (c) {
+    case 'O': case 'D': case 'Q': return '0';
+    case 'I': return '1';
+    case 'B': return '8';
+    case 'Z': return '2';
+    case 'S': return '5';
+    case 'G': return '6';
+    default: return c;
+    }
+}
+
+// 归一化 (去分隔符, 转大写) 并生成归并键
+static void make_keys(const char* plate, char* norm, char* canon) {
+    int n = 0;
+    for (const unsigned char* p = (const unsigned char*)plate; *p && n < KEY_SIZE - 1; p++) {
+        if (p[0] == 0xC2 && p[1] == 0xB7) { p++; continue; } // '·'
+        if (*p == '.' || *p == '-' || *p == ' ' || *p == '\t') continue;
+        norm[n++] = (char)toupper(*p);
+    }
+    memset(norm + n, 0, KEY_SIZE - n);
+    for (int i = 0; i < KEY_SIZE; i++) canon[i] = confusion_class(norm[i]);
+}
+
+static int utf8_len(unsigned char c) {
+    if (c < 0x80) return 1;
+    if (c >= 0xF0) return 4;
+    if (c >= 0xE0) return 3;
+    return 2;
+}
+
+static int cmp_entry(const void* a, const void* b) {
+    const ListEntry* x = a;
+    const ListEntry* y = b;
+    int c = memcmp(x->canon, y->canon, KEY_SIZE);
+    return c ? c : memcmp(x->plate, y->plate, KEY_SIZE);
+}
+
+// --- 编译: 文本名单 -> 排序数组 ---
+
+static ListEntry* compile_text(const char* path, uint32_t* count) {
+    FILE* f = fopen(path, "r");
+    if (!f) return NULL;
+    uint32_t cap = 1024, n = 0;
+    ListEntry* e = malloc(cap * sizeof(ListEntry));
+    char line[256];
+    int lineno = 0;
+    while (e && fgets(line, sizeof(line), f)) {
+        lineno++;
+        line[strcspn(line, "\r\n#")] = '\0';
+        char* plate = line;
+        while (isspace((unsigned char)*plate)) plate++;
+        if (*plate == '\0') continue;
+
+        int type = PLATE_LIST_ALLOW;
+        char* comma = strchr(plate, ',');
+        if (comma) {
+            *comma = '\0';
+            char* t = comma + 1;
+            while (isspace((unsigned char)*t)) t++;
+            if (strncmp(t, "deny", 4) == 0) type = PLATE_LIST_DENY;
+            else if (strncmp(t, "allow", 5) != 0 && *t) {
+                printf("[List] %s:%d 未知类型 %s, 按 allow 处理\n", path, lineno, t);
+            }
+        }
+
+        if (n == cap) {
+            cap *= 2;
+            ListEntry* ne = realloc(e, cap * sizeof(ListEntry));
+            if (!ne) { free(e); e = NULL; break; }
+            e = ne;
+        }
+        memset(&e[n], 0, sizeof(ListEntry));
+        make_keys(plate, e[n].plate, e[n].canon);
+        if (e[n].plate[0] == '\0') continue;
+        e[n].type = type;
+        n++;
+    }
+    fclose(f);
+    if (!e) return NULL;
+
+    qsort(e, n, sizeof(ListEntry), cmp_entry);
+    // 去重: 同一车牌同时出现在两种名单中时以 deny 为准
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (m > 0 && memcmp(e[m - 1].plate, e[i].plate, KEY_SIZE) == 0) {
+            if (e[i].type == PLATE_LIST_DENY) e[m - 1].type = PLATE_LIST_DENY;
+            continue;
+        }
+        e[m++] = e[i];
+    }
+    *count = m;
+    return e;
+}
+
+static int64_t mtime_ns(const struct stat* st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static int write_idx(const char* idx_path, const ListEntry* e, uint32_t n, const struct stat* src) {
+    char tmp[320];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", idx_path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    ListHeader h = { LIST_MAGIC, LIST_VERSION, n, mtime_ns(src), (int64_t)src->st_size };
+    FILE* f = fdopen(fd, "wb");
+    int ok = f && fwrite(&h, sizeof(h), 1, f) == 1 &&
+             (n == 0 || fwrite(e, sizeof(ListEntry), n, f) == n);
+    if (f) ok = (fclose(f) == 0) && ok;
+    else close(fd);
+    if (!ok || rename(tmp, idx_path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static int map_idx(const char* idx_path, const struct stat* src, PlateList* l) {
+    int fd = open(idx_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ListHeader)) {
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+
+    const ListHeader* h = p;
+    if (h->magic != LIST_MAGIC || h->version != LIST_VERSION ||
+        h->src_mtime != mtime_ns(src) || h->src_size != (int64_t)src->st_size ||
+        (size_t)st.st_size != sizeof(ListHeader) + h->count * sizeof(ListEntry)) {
+        munmap(p, st.st_size);
+        return -1;
+    }
+    l->map = p;
+    l->map_len = st.st_size;
+    l->e = (const ListEntry*)(h + 1);
+    l->n = (uint32_t)h->count;
+    return 0;
+}
+
+static void list_free(PlateList* l) {
+    if (!l) return;
+    if (l->map) munmap(l->map, l->map_len);
+    free(l->heap);
+    free(l);
+}
+
+static PlateList* list_acquire() {
+    pthread_mutex_lock(&g_list_lock);
+    PlateList* l = g_list;
+    if (l) l->refs++;
+    pthread_mutex_unlock(&g_list_lock);
+    return l;
+}
+
+static void list_release(PlateList* l) {
+    if (!l) return;
+    pthread_mutex_lock(&g_list_lock);
+    int free_it = --l->refs == 0;
+    pthread_mutex_unlock(&g_list_lock);
+    if (free_it) list_free(l);
+}
+
+int plate_list_load(const char* path) {
+    struct stat src;
+    if (stat(path, &src) != 0) {
+        printf("[List] 名单文件 %s 不存在\n", path);
+        return -1;
+    }
+    PlateList* l = calloc(1, sizeof(PlateList));
+    if (!l) return -1;
+    l->refs = 1;
+
+    char idx_path[300];
+    snprintf(idx_path, sizeof(idx_path), "%s.idx", path);
+    if (map_idx(idx_path, &src, l) != 0) {
+        // .idx 不存在或已过期: 重新编译
+        uint32_t n = 0;
+        ListEntry* e = compile_text(path, &n);
+        if (!e) {
+            printf("[List] 无法读取名单 %s\n", path);
+            free(l);
+            return -1;
+        }
+        if (write_idx(idx_path, e, n, &src) == 0 && map_idx(idx_path, &src, l) == 0) {
+            free(e);
+        } else {
+            // 目录不可写时直接使用内存中的副本
+            l->heap = e;
+            l->e = e;
+            l->n = n;
+        }
+    }
+
+    pthread_mutex_lock(&g_list_lock);
+    PlateList* old = g_list;
+    g_list = l;
+    int free_old = old && --old->refs == 0;
+    pthread_mutex_unlock(&g_list_lock);
+    if (free_old) list_free(old);
+
+    printf("[List] 名单已加载: %s (%u 条)\n", path, l->n);
+    return 0;
+}
+
+void plate_list_unload() {
+    pthread_mutex_lock(&g_list_lock);
+    PlateList* old = g_list;
+    g_list = NULL;
+    int free_old = old && --old->refs == 0;
+    pthread_mutex_unlock(&g_list_lock);
+    if (free_old) list_free(old);
+}
+
+int plate_list_size() {
+    PlateList* l = list_acquire();
+    int n = l ? (int)l->n : 0;
+    list_release(l);
+    return n;
+}
+
+// --- 匹配 ---
+
+typedef struct {
+    const ListEntry* e;
+    uint32_t qc[MAX_CHARS];  // 查询串的字符 (UTF-8 字节打包)
+    int qoff[MAX_CHARS + 1]; // 每个字符在查询归并键中的字节偏移
+    int qn;
+    const char* qkey;
+    int best;                // 当前最优距离 (剪枝上限)
+    int allow_max;           // 白名单条目允许的最大距离
+    const ListEntry* hit;
+} SearchCtx;
+
+static uint32_t pack_char(const char* s, int len) {
+    uint32_t v = 0;
+    for (int i = 0; i < len; i++) v = (v << 8) | (unsigned char)s[i];
+    return v;
+}
+
+static void consider(SearchCtx* c, const ListEntry* e, int d) {
+    // 近似命中白名单不能放行, 超出白名单预算的条目不算命中
+    if (e->type == PLATE_LIST_ALLOW && d > c->allow_max) return;
+    // 距离相同时优先报告黑名单, 宁可拦截人工复核
+    if (d < c->best || (d == c->best && (!c->hit || (e->type == PLATE_LIST_DENY && c->hit->type != PLATE_LIST_DENY)))) {
+        c->best = d;
+        c->hit = e;
+    }
+}
+
+// 剩余编辑预算为 0 时, 子树中只有"已匹配前缀 + 查询串第 j 个字符之后的部分"可能命中,
+// 直接二分查找该完整键, 无需逐个展开子节点
+static void exact_suffix(SearchCtx* c, uint32_t lo, uint32_t hi, int off, int j, int d) {
+    int tail = c->qoff[c->qn] - c->qoff[j];
+    if (off + tail > KEY_SIZE - 1) return;
+    char key[KEY_SIZE] = {0};
+    memcpy(key, c->e[lo].canon, off);
+    memcpy(key + off, c->qkey + c->qoff[j], tail);
+
+    uint32_t a = lo, b = hi;
+    while (a < b) {
+        uint32_t mid = a + (b - a) / 2;
+        if (memcmp(c->e[mid].canon, key, KEY_SIZE) < 0) a = mid + 1;
+        else b = mid;
+    }
+    for (; a < hi && memcmp(c->e[a].canon, key, KEY_SIZE) == 0; a++) {
+        consider(c, &c->e[a], d);
+    }
+}
+
+// [lo, hi) 内的条目共享前 off 字节; prev 为上一层的编辑距离行
+static void search(SearchCtx* c, uint32_t lo, uint32_t hi, int off, const int* prev) {
+    // 在此结束的条目 ('\0' 排在最前)
+    while (lo < hi && (off >= KEY_SIZE || c->e[lo].canon[off] == '\0')) {
+        consider(c, &c->e[lo], prev[c->qn]);
+        lo++;
+    }
+
+    int cur[MAX_CHARS + 1];
+    while (lo < hi) {
+        const char* ch = c->e[lo].canon + off;
+        int len = utf8_len((unsigned char)ch[0]);
+        if (off + len > KEY_SIZE) len = KEY_SIZE - off;
+
+        // 同一字符的子树末尾 (二分)
+        uint32_t a = lo + 1, b = hi;
+        while (a < b) {
+            uint32_t mid = a + (b - a) / 2;
+            if (memcmp(c->e[mid].canon + off, ch, len) == 0) a = mid + 1;
+            else b = mid;
+        }
+        uint32_t end = a;
+
+        uint32_t code = pack_char(ch, len);
+        cur[0] = prev[0] + 1;
+        int row_min = cur[0];
+        for (int j = 1; j <= c->qn; j++) {
+            int v = prev[j - 1] + (c->qc[j - 1] != code);
+            if (prev[j] + 1 < v) v = prev[j] + 1;
+            if (cur[j - 1] + 1 < v) v = cur[j - 1] + 1;
+            cur[j] = v;
+            if (v < row_min) row_min = v;
+        }
+        if (row_min < c->best) {
+            search(c, lo, end, off + len, cur);
+        } else if (row_min == c->best) {
+            for (int j = 0; j <= c->qn; j++) {
+                if (cur[j] == row_min) exact_suffix(c, lo, end, off + len, j, row_min);
+            }
+        }
+        lo = end;
+    }
+}
+
+int plate_list_match(const char* plate, int max_edits, int allow_max_edits, PlateListMatch* out) {
+    memset(out, 0, sizeof(*out));
+    PlateList* l = list_acquire();
+    if (!l || l->n == 0) {
+        list_release(l);
+        return 0;
+    }
+
+    char norm[KEY_SIZE], canon[KEY_SIZE];
+    make_keys(plate, norm, canon);
+
+    // 1. 归并键完全一致: 精确命中或仅易混字符不同
+    uint32_t lo = 0, hi = l->n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (memcmp(l->e[mid].canon, canon, KEY_SIZE) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    const ListEntry* hit = NULL;
+    for (uint32_t i = lo; i < l->n && memcmp(l->e[i].canon, canon, KEY_SIZE) == 0; i++) {
+        if (memcmp(l->e[i].plate, norm, KEY_SIZE) == 0) {
+            hit = &l->e[i];
+            out->exact = 1;
+            break;
+        }
+        if (!hit || l->e[i].type == PLATE_LIST_DENY) hit = &l->e[i];
+    }
+
+    // 2. 有界编辑距离搜索
+    if (!hit && max_edits > 0) {
+        SearchCtx c = { .e = l->e, .qn = 0, .qkey = canon, .best = max_edits, .allow_max = allow_max_edits, .hit = NULL };
+        int off = 0;
+        while (off < KEY_SIZE && canon[off] && c.qn < MAX_CHARS) {
+            int len = utf8_len((unsigned char)canon[off]);
+            if (off + len > KEY_SIZE) break;
+            c.qoff[c.qn] = off;
+            c.qc[c.qn++] = pack_char(canon + off, len);
+            off += len;
+        }
+        c.qoff[c.qn] = off;
+        int row[MAX_CHARS + 1];
+        for (int j = 0; j <= c.qn; j++) row[j] = j;
+        search(&c, 0, l->n, 0, row);
+        if (c.hit) {
+            hit = c.hit;
+            out->distance = c.best;
+        }
+    }
+
+    if (hit) {
+        out->type = hit->type;
+        memcpy(out->plate, hit->plate, KEY_SIZE);
+    }
+    list_release(l);
+    return hit != NULL;
+}
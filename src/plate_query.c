@@ -0,0 +1,85 @@
+// 车牌事件查询工具: ./plate_query [-c 配置文件] [-n 条数] <车牌前缀|-> [起始时间] [结束时间]
+// 时间格式 "YYYY-MM-DD" 或 "YYYY-MM-DD HH:MM:SS" (本地时间)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "include/plate_store.h"
+#include "include/utils.h"
+
+static int parse_time(const char* s, int64_t* out) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char* end = strptime(s, "%Y-%m-%d %H:%M:%S", &tm);
+    if (!end || *end) {
+        memset(&tm, 0, sizeof(tm));
+        end = strptime(s, "%Y-%m-%d", &tm);
+        if (!end || *end) return -1;
+    }
+    tm.tm_isdst = -1;
+    *out = (int64_t)mktime(&tm) * 1000000LL;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* config_path = "config/system.conf";
+    int limit = 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:n:")) != -1) {
+        if (opt == 'c') config_path = optarg;
+        else if (opt == 'n') limit = atoi(optarg);
+        else break;
+    }
+    if (optind >= argc || limit <= 0) {
+        printf("用法: %s [-c 配置文件] [-n 条数] <车牌前缀|-> [起始时间] [结束时间]\n", argv[0]);
+        return 1;
+    }
+
+    const char* prefix = strcmp(argv[optind], "-") == 0 ? NULL : argv[optind];
+    int64_t from = INT64_MIN, to = INT64_MAX;
+    if (optind + 1 < argc && parse_time(argv[optind + 1], &from) != 0) {
+        printf("无法解析起始时间: %s\n", argv[optind + 1]);
+        return 1;
+    }
+    if (optind + 2 < argc && parse_time(argv[optind + 2], &to) != 0) {
+        printf("无法解析结束时间: %s\n", argv[optind + 2]);
+        return 1;
+    }
+
+    AppConfig config;
+    config_set_defaults(&config);
+    load_config(config_path, &config);
+
+    PlateStoreConfig store_cfg = {
+        .segment_records = config.store_segment_records,
+        .merge_records = config.store_merge_records,
+        .read_only = 1
+    };
+    snprintf(store_cfg.dir, sizeof(store_cfg.dir), "%s", config.store_dir);
+    PlateStore* store = plate_store_open(&store_cfg);
+    if (!store) return 1;
+
+    PlateRecord* out = malloc(limit * sizeof(PlateRecord));
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int n = plate_store_query(store, prefix, from, to, out, limit);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    for (int i = 0; i < n; i++) {
+        time_t sec = (time_t)(out[i].wall_time_us / 1000000);
+        struct tm tm;
+        char buf[32];
+        localtime_r(&sec, &tm);
+        strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+        printf("%s  %-12s  置信度 %.2f%s\n", buf, out[i].plate_text, out[i].confidence,
+               out[i].is_fraud ? "  [欺诈]" : "");
+    }
+    printf("共 %d 条 (查询耗时 %.3f ms)\n", n,
+           (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+
+    free(out);
+    plate_store_close(store);
+    return 0;
+}
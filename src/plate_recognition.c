@@ -2,20 +2,132 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 #include "include/plate_recognition.h"
 #include "include/onnx_inference.h"
 #include "include/image_utils.h"
+#include "include/plate_list.h"
+#include "include/anti_fraud.h"
+#include "include/task_pool.h"
+#include "include/trace.h"
 
 static ONNXModel g_net_vehicle;
 static ONNXModel g_net_plate;
 static ONNXModel g_net_ocr;
+static ONNXModel g_net_ocr_fast;   // 分级识别的快速模型 (可选)
+static int g_ocr_fast_loaded = 0;
+
+static TaskPool* g_vehicle_pool = NULL; // 车辆子流水线线程池 (NULL 时在处理线程中依次执行)
+
+// --- 车辆跟踪: 按 IoU 关联相邻帧中的同一辆车, 只对画质更好的车牌截图做 OCR.
+//     第一次读出车牌即输出事件, 之后同一读数的更清晰截图只作为截图更新输出 ---
+#define MAX_TRACKS 16
+#define TRACK_EXPIRE_FRAMES 30
+#define TRACK_IDLE_FRAMES 5      // 轨迹隔了这么多帧才再次出现: 可能已换了一辆车, 重新识别
+#define TRACK_JUMP_IOU 0.5f      // 与上一帧框的 IoU 低于该值: 同上
+#define TRACK_RECHECK_FRAMES 15  // 距上次 OCR 超过该帧数时不论画质都复核一次 (排队时后车停在前车的位置)
+
+typedef struct {
+    int active;
+    float box[4];        // x1, y1, x2, y2
+    int last_frame;
+    float best_quality;  // 已输出截图的最佳质量
+    int has_reading;     // 已输出事件
+    char reading[64];    // 已输出的读数
+    int last_ocr;        // 上次 OCR 的帧号
+    int recheck;         // 下一张合格截图不论画质都重新识别
+} VehicleTrack;
+
+// 每路视频流的状态: 跟踪表只在调用 process_frames 的线程中修改
+struct FrameContext {
+    VehicleTrack tracks[MAX_TRACKS];
+    int frame_no;
+    int last_vehicle_count;
+    FrameTiming last_timing;
+};
+
+static FrameContext g_default_ctx; // process_frame 使用
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static float box_iou(const float* a, const float* b) {
+    float iw = fminf(a[2], b[2]) - fmaxf(a[0], b[0]);
+    float ih = fminf(a[3], b[3]) - fmaxf(a[1], b[1]);
+    if (iw <= 0 || ih <= 0) return 0.0f;
+    float inter = iw * ih;
+    float area_a = (a[2] - a[0]) * (a[3] - a[1]);
+    float area_b = (b[2] - b[0]) * (b[3] - b[1]);
+    return inter / (area_a + area_b - inter + 1e-6f);
+}
+
+// 找到与检测框对应的轨迹, 没有则新建 (复用过期或最久未见的槽位); 槽位用尽时返回 NULL
+static VehicleTrack* track_vehicle(FrameContext* fc, const Detection* d) {
+    float box[4] = { d->x1, d->y1, d->x2, d->y2 };
+    VehicleTrack* best = NULL;
+    float best_iou = 0.3f;
+    VehicleTrack* slot = &fc->tracks[0];
+
+    for (int i = 0; i < MAX_TRACKS; i++) {
+        VehicleTrack* t = &fc->tracks[i];
+        if (t->active && fc->frame_no - t->last_frame > TRACK_EXPIRE_FRAMES) t->active = 0;
+        // 本帧已关联过的轨迹不再参与匹配, 保证每条轨迹只属于一个车辆任务
+        if (t->active && t->last_frame != fc->frame_no) {
+            float iou = box_iou(t->box, box);
+            if (iou > best_iou) { best_iou = iou; best = t; }
+        }
+        if (!t->active) { if (slot->active) slot = t; }
+        else if (slot->active && t->last_frame < slot->last_frame) slot = t;
+    }
+    if (!best) {
+        if (slot->active && slot->last_frame == fc->frame_no) return NULL; // 本帧车辆数超过轨迹槽位
+        best = slot;
+        memset(best, 0, sizeof(*best));
+        best->active = 1;
+    } else if (fc->frame_no - best->last_frame > TRACK_IDLE_FRAMES || best_iou < TRACK_JUMP_IOU) {
+        best->recheck = 1;
+    }
+    memcpy(best->box, box, sizeof(box));
+    best->last_frame = fc->frame_no;
+    return best;
+}
 
 // --- OCR 字典相关 ---
-static char** g_keys = NULL;
-static int g_keys_count = 0;
+typedef struct {
+    char** keys;
+    unsigned char* kind;   // 字典字符类别, 用于按号牌语法限制每一位可输出的字符
+    int count;
+} OcrDict;
+
+static OcrDict g_dict;        // 完整识别模型的字典
+static OcrDict g_fast_dict;   // 快速模型的字典 (未单独配置时不加载, 与 g_dict 相同)
+
+enum { KEY_OTHER = 0, KEY_PROVINCE, KEY_LETTER, KEY_DIGIT, KEY_SUFFIX };
+
+static const char* PROVINCE_CHARS = "京沪津渝冀晋蒙辽吉黑苏浙皖闽赣鲁豫鄂湘粤桂琼川贵云藏陕甘青宁新";
+static const char* SUFFIX_CHARS = "港澳使领学警挂";
+
+static int utf8_char_in(const char* ch, const char* set) {
+    if (strlen(ch) != 3) return 0;
+    for (const char* p = set; *p; p += 3) {
+        if (memcmp(p, ch, 3) == 0) return 1;
+    }
+    return 0;
+}
+
+static unsigned char classify_key(const char* ch) {
+    if (ch[0] >= 'A' && ch[0] <= 'Z' && !ch[1]) return KEY_LETTER;
+    if (ch[0] >= '0' && ch[0] <= '9' && !ch[1]) return KEY_DIGIT;
+    if (utf8_char_in(ch, PROVINCE_CHARS)) return KEY_PROVINCE;
+    if (utf8_char_in(ch, SUFFIX_CHARS)) return KEY_SUFFIX;
+    return KEY_OTHER;
+}
 
 // 加载字典文件
-int load_ocr_keys(const char* filename) {
+int load_ocr_keys(OcrDict* dict, const char* filename) {
     FILE* f = fopen(filename, "r");
     if (!f) {
         printf("错误: 无法打开字典文件 %s\n", filename);
@@ -28,27 +140,31 @@ int load_ocr_keys(const char* filename) {
     while (fgets(line, sizeof(line), f)) count++;
     rewind(f);
 
-    g_keys_count = count;
-    g_keys = malloc(count * sizeof(char*));
+    dict->count = count;
+    dict->keys = malloc(count * sizeof(char*));
+    dict->kind = calloc(count, 1);
 
     // 2. 读取内容
     int i = 0;
     while (fgets(line, sizeof(line), f) && i < count) {
         // 去掉换行符
         line[strcspn(line, "\r\n")] = 0;
-        g_keys[i] = strdup(line);
+        dict->keys[i] = strdup(line);
+        dict->kind[i] = classify_key(line);
         i++;
     }
     fclose(f);
-    printf("[System] OCR字典加载完成，共 %d 个字符\n", g_keys_count);
+    printf("[System] OCR字典加载完成，共 %d 个字符\n", dict->count);
     return 0;
 }
 
 // 释放字典
-void free_ocr_keys() {
-    if (g_keys) {
-        for(int i=0; i<g_keys_count; i++) free(g_keys[i]);
-        free(g_keys);
+void free_ocr_keys(OcrDict* dict) {
+    if (dict->keys) {
+        for(int i=0; i<dict->count; i++) free(dict->keys[i]);
+        free(dict->keys);
+        free(dict->kind);
+        memset(dict, 0, sizeof(*dict));
     }
 }
 
@@ -137,8 +253,8 @@ void optimize_char_confusion(char* text) {
     }
 }
 
-// 识别符合车牌规则
-int fix_and_validate_plate(char* plate_text) {
+// 识别符合车牌规则 (7~8 位; 蓝牌/绿牌不允许末位特殊用途字)
+int fix_and_validate_plate(char* plate_text, PlateColor color) {
     if (!plate_text || strlen(plate_text) < 7) return 0;
 
     // 1. 检查首字是否为省份
@@ -152,15 +268,26 @@ int fix_and_validate_plate(char* plate_text) {
     
     memcpy(clean_buf, plate_text, 3);
     int clean_idx = 3;
+    int chars = 1;
 
-    while (plate_text[i] != '\0') {
+    while (plate_text[i] != '\0' && clean_idx < (int)sizeof(clean_buf) - 4) {
         char c = plate_text[i];
         
         if (is_valid_alphanum(c)) {
             clean_buf[clean_idx++] = c;
+            chars++;
         }
         else if ((unsigned char)c > 127) {
-
+            if (!plate_text[i + 1] || !plate_text[i + 2]) break;
+            // 特殊用途字 (学/警/挂...) 只允许出现在末位
+            char ch[4] = {0};
+            memcpy(ch, plate_text + i, 3);
+            if (plate_text[i + 3] == '\0' && chars == 6 && utf8_char_in(ch, SUFFIX_CHARS) &&
+                color != PLATE_COLOR_BLUE && color != PLATE_COLOR_GREEN) {
+                memcpy(clean_buf + clean_idx, ch, 3);
+                clean_idx += 3;
+                chars++;
+            }
         }
 
         if ((unsigned char)c > 127) i += 3;
@@ -169,8 +296,7 @@ int fix_and_validate_plate(char* plate_text) {
     clean_buf[clean_idx] = '\0';
     
     // 3. 长度校验
-    int final_len = strlen(clean_buf);
-    if (final_len < 7 || final_len > 9) return 0;
+    if (chars < 7 || chars > 8) return 0;
     
     // 覆盖回原字符串
     strcpy(plate_text, clean_buf);
@@ -186,254 +312,872 @@ static void save_plate_debug(const char* filename, unsigned char* rgb, int w, in
     printf("[DEBUG] 车牌图片已保存: %s (%dx%d)\n", filename, w, h);
 }
 
-int system_init(AppConfig* config) {
-    if(onnx_model_init(&g_net_vehicle, config->vehicle_model) != 0) return -1;
-    if(onnx_model_init(&g_net_plate, config->plate_model) != 0) return -1;
-    if(onnx_model_init(&g_net_ocr, config->ocr_model) != 0) return -1;
-    if(load_ocr_keys("models/ppocr_keys_v1.txt") != 0) return -1;
+int system_init(AppConfig* config, const CpuPlacement* placement) {
+    // 三个模型共用一个 ORT 环境与全局线程池
+    OnnxRuntimeOptions ort_opts;
+    onnx_runtime_default_options(&ort_opts);
+    ort_opts.intra_op_threads = config->intra_op_threads;
+    ort_opts.inter_op_threads = config->inter_op_threads;
+    ort_opts.allow_spinning = config->allow_spinning;
+    ort_opts.graph_optimization = config->graph_optimization;
+    ort_opts.parallel_execution = config->parallel_execution;
+    if (placement) cpu_list_format(&placement->ort, 1, ort_opts.intra_affinity, sizeof(ort_opts.intra_affinity));
+    snprintf(ort_opts.xnnpack_options, sizeof(ort_opts.xnnpack_options), "%s", config->xnnpack_options);
+    snprintf(ort_opts.dnnl_options, sizeof(ort_opts.dnnl_options), "%s", config->dnnl_options);
+    snprintf(ort_opts.openvino_options, sizeof(ort_opts.openvino_options), "%s", config->openvino_options);
+    if (onnx_runtime_init(&ort_opts) != 0) return -1;
+
+    plate_color_init();
+    if(onnx_model_init(&g_net_vehicle, config->vehicle_model, config->vehicle_providers) != 0) return -1;
+    if(onnx_model_init(&g_net_plate, config->plate_model, config->plate_providers) != 0) return -1;
+    if(onnx_model_init(&g_net_ocr, config->ocr_model, config->ocr_providers) != 0) return -1;
+    // 快速识别模型: 加载失败时分级识别退化为完整模型窄输入
+    if (config->ocr_fast_model[0]) {
+        g_ocr_fast_loaded = onnx_model_init(&g_net_ocr_fast, config->ocr_fast_model, config->ocr_providers) == 0;
+        if (!g_ocr_fast_loaded) printf("[System] 快速识别模型加载失败, 分级识别改用完整模型\n");
+    }
+
+    // 车辆子流水线线程与 ORT 线程池绑在同一组 CPU 上; 不能依赖继承,
+    // 此时调用线程 (主线程) 尚未绑核, 之后绑核也不会影响已创建的线程
+    g_vehicle_pool = task_pool_create(config->vehicle_workers, placement ? &placement->ort : NULL);
+    if(load_ocr_keys(&g_dict, config->ocr_keys) != 0) return -1;
+    if (g_ocr_fast_loaded && config->ocr_fast_keys[0] && load_ocr_keys(&g_fast_dict, config->ocr_fast_keys) != 0) return -1;
     return 0;
 }
 
 void system_cleanup() {
+    task_pool_destroy(g_vehicle_pool);
+    g_vehicle_pool = NULL;
     onnx_model_cleanup(&g_net_vehicle);
     onnx_model_cleanup(&g_net_plate);
     onnx_model_cleanup(&g_net_ocr);
-    free_ocr_keys();
+    onnx_model_cleanup(&g_net_ocr_fast);
+    g_ocr_fast_loaded = 0;
+    free_ocr_keys(&g_dict);
+    free_ocr_keys(&g_fast_dict);
+}
+
+int system_profiling_begin(const char* dir) {
+    ONNXModel* models[] = { &g_net_vehicle, &g_net_plate, &g_net_ocr, &g_net_ocr_fast };
+    static const char* names[] = { "vehicle", "plate", "ocr", "ocr_fast" };
+    int started = 0;
+    for (int i = 0; i < 4; i++) {
+        char prefix[512];
+        snprintf(prefix, sizeof(prefix), "%s/ort_%s", dir, names[i]);
+        if (onnx_model_profile_begin(models[i], prefix) == 0) started++;
+    }
+    return started > 0 ? 0 : -1;
+}
+
+int system_profiling_end(TraceOrtProfile* out, int max) {
+    ONNXModel* models[] = { &g_net_vehicle, &g_net_plate, &g_net_ocr, &g_net_ocr_fast };
+    static const char* names[] = { "车辆检测", "车牌定位", "OCR", "OCR 快速" };
+    int n = 0;
+    for (int i = 0; i < 4; i++) {
+        if (n < max && onnx_model_profile_end(models[i], out[n].file, sizeof(out[n].file), &out[n].start_ns) == 0) {
+            out[n].model = names[i];
+            n++;
+        }
+    }
+    return n;
+}
+
+void system_providers(char* buf, size_t size) {
+    snprintf(buf, size, "vehicle=%s plate=%s ocr=%s%s%s", g_net_vehicle.provider, g_net_plate.provider,
+             g_net_ocr.provider, g_ocr_fast_loaded ? " ocr_fast=" : "", g_ocr_fast_loaded ? g_net_ocr_fast.provider : "");
+}
+
+void free_results(DetectionResult* results, int count) {
+    if (!results) return;
+    for (int i = 0; i < count; i++) free(results[i].plate_img);
+    free(results);
+}
+
+int last_frame_vehicle_count() {
+    return g_default_ctx.last_vehicle_count;
+}
+
+void last_frame_timing(FrameTiming* out) {
+    *out = g_default_ctx.last_timing;
+}
+
+int last_frame_track_readings(char texts[][64], int max) {
+    int n = 0;
+    for (int i = 0; i < MAX_TRACKS && n < max; i++) {
+        const VehicleTrack* t = &g_default_ctx.tracks[i];
+        if (t->active && t->has_reading && t->last_frame == g_default_ctx.frame_no) {
+            memcpy(texts[n++], t->reading, sizeof(t->reading));
+        }
+    }
+    return n;
+}
+
+void reset_vehicle_tracks() {
+    memset(g_default_ctx.tracks, 0, sizeof(g_default_ctx.tracks));
+}
+
+FrameContext* frame_context_create() {
+    return calloc(1, sizeof(FrameContext));
 }
 
-void decode_ocr_real(float* data, int seq_len, int num_classes, char* buffer) {
+void frame_context_destroy(FrameContext* fc) {
+    free(fc);
+}
+
+// 第 pos 位 (从 0 开始) 允许输出的字符类别
+// 号牌最长 8 位; 位数是否与底色相符留给防欺诈检查 (蓝底 8 位号牌属于可疑, 不应被截断成 7 位)
+static unsigned grammar_mask(int pos, PlateColor color) {
+    int suffix_ok = color != PLATE_COLOR_BLUE && color != PLATE_COLOR_GREEN;
+
+    if (pos == 0) return 1u << KEY_PROVINCE;
+    if (pos == 1) return 1u << KEY_LETTER;
+    if (pos >= 8) return 0;
+    unsigned mask = 1u << KEY_LETTER | 1u << KEY_DIGIT;
+    if (pos == 6 && suffix_ok) mask |= 1u << KEY_SUFFIX;
+    return mask;
+}
+
+// CTC 贪心解码, 返回输出字符的平均置信度, min_conf 返回最低的单字符置信度
+// 每个时间步先取不受限的最大类别: blank 或与上一步相同 (同一字符的重复帧) 不输出;
+// 确定要输出新字符时, 才在号牌语法允许的字符中取最大值 (特殊用途字是否可用取决于底色)
+float decode_ocr_real(const OcrDict* dict, float* data, int seq_len, int num_classes, PlateColor color,
+                      char* buffer, int buffer_size, float* min_conf) {
     buffer[0] = '\0';
-    int last_index = -1; 
-    
-    // 调试缓冲区
-    char debug_buf[256] = {0};
-    int has_valid_char = 0;
+    int last_index = -1;
+    float conf_sum = 0.0f;
+    int conf_cnt = 0;
+    *min_conf = 0.0f;
 
+    int pos = 0;
+    int limit = num_classes < dict->count + 1 ? num_classes : dict->count + 1;
     for (int t = 0; t < seq_len; t++) {
-        float max_score = -10000.0f;
-        int max_idx = 0;
-        
         float* current_step_data = data + t * num_classes;
-        for (int c = 0; c < num_classes; c++) {
-            if (current_step_data[c] > max_score) {
-                max_score = current_step_data[c];
-                max_idx = c;
-            }
+        int max_idx = 0;
+        for (int c = 1; c < limit; c++) {
+            if (current_step_data[c] > current_step_data[max_idx]) max_idx = c;
         }
-
         // CTC 去重逻辑
-        if (max_idx != 0 && max_idx != last_index) {
-            int dict_idx = max_idx - 1;
-            
-            // 调试打印：记录下看到了什么索引
-            char tmp[32];
-            snprintf(tmp, 32, "%d(%.2f) ", dict_idx, max_score);
-            strcat(debug_buf, tmp);
-            has_valid_char = 1;
-
-            if (dict_idx >= 0 && dict_idx < g_keys_count) {
-                strcat(buffer, g_keys[dict_idx]);
-            } else {
-                strcat(buffer, "?"); 
+        int emit = max_idx != 0 && max_idx != last_index;
+        last_index = max_idx;
+        if (!emit) continue;
+
+        unsigned allowed = grammar_mask(pos, color);
+        int best = -1;
+        for (int c = 1; c < limit && allowed; c++) {
+            if (!(allowed >> dict->kind[c - 1] & 1u)) continue;
+            if (best < 0 || current_step_data[c] > current_step_data[best]) best = c;
+        }
+        if (best < 0) continue; // 已到号牌最大位数
+
+        const char* ch = dict->keys[best - 1];
+        float score = current_step_data[best];
+        if (strlen(buffer) + strlen(ch) < (size_t)buffer_size) {
+            strcat(buffer, ch);
+            conf_sum += score;
+            if (conf_cnt == 0 || score < *min_conf) *min_conf = score;
+            conf_cnt++;
+            pos++;
+        }
+    }
+    return conf_cnt > 0 ? conf_sum / conf_cnt : 0.0f;
+}
+
+// 输出类别数: PP-OCR 为 字典 + blank + 空格, 部分导出不含空格
+static int ocr_num_classes(const OcrDict* dict, size_t len) {
+    if (len % (dict->count + 2) == 0) return dict->count + 2;
+    if (len % (dict->count + 1) == 0) return dict->count + 1;
+    return 0;
+}
+
+// 一次 OCR 的读数
+typedef struct {
+    char text[64];
+    float confidence;   // 字符平均置信度
+    float min_char;     // 最低的单字符置信度
+    int valid;          // 通过号牌规则校验
+} OcrReading;
+
+// 用指定模型识别一张车牌截图: 预处理 -> 推理 -> 按号牌语法解码 -> 清洗与规则校验; 推理失败返回 -1
+static int ocr_read(ONNXModel* model, const OcrDict* dict, int ocr_w, const Image* img,
+                    PlateColor color, OcrReading* out, int v) {
+    uint64_t ts = trace_begin();
+    void* ocr_in = malloc(1*3*48*ocr_w*(model->input_u8 ? 1 : sizeof(float)));
+    if (model->input_u8) preprocess_ocr_u8(img, ocr_w, ocr_in);
+    else preprocess_ocr(img, ocr_w, ocr_in);
+    trace_end(ts, "ocr.preprocess", v);
+
+    float* ocr_out = NULL; size_t ocr_len = 0;
+    ts = trace_begin();
+    int ret = onnx_model_run_image(model, ocr_in, 48, ocr_w, &ocr_out, &ocr_len);
+    trace_end(ts, "ocr.infer", v);
+    free(ocr_in);
+    if (ret != 0) return -1;
+
+    ts = trace_begin();
+    memset(out, 0, sizeof(*out));
+    int num_classes = ocr_num_classes(dict, ocr_len);
+    if (num_classes > 0) {
+        out->confidence = decode_ocr_real(dict, ocr_out, ocr_len / num_classes, num_classes, color,
+                                          out->text, sizeof(out->text), &out->min_char);
+        // 去除点号, 混淆修正, 强规则校验和清洗
+        clean_plate_text(out->text);
+        optimize_char_confusion(out->text);
+        out->valid = fix_and_validate_plate(out->text, color);
+    }
+    trace_end(ts, "ocr.decode", v);
+    free(ocr_out);
+    return num_classes > 0 ? 0 : -1;
+}
+
+// 读数足够可信, 不再升级
+static int ocr_accept(const OcrReading* r, float min_char) {
+    return r->valid && r->min_char >= min_char;
+}
+
+// a 是否比 b 更可信: 先看规则校验, 再看最低字符置信度
+static int ocr_better(const OcrReading* a, const OcrReading* b) {
+    if (a->valid != b->valid) return a->valid;
+    return a->min_char > b->min_char;
+}
+
+// 车牌框以中心按倍数扩张并裁到画面内
+// DBNet 找出的框是收缩的 (Shrunk), 必须放大才能包含完整文字
+static void expand_plate_box(const int raw[4], float expand_w, float expand_h, int w, int h, int box[4]) {
+    int center_x = raw[0] + raw[2]/2;
+    int center_y = raw[1] + raw[3]/2;
+    int gw = (int)(raw[2] * expand_w);
+    int gh = (int)(raw[3] * expand_h);
+    int gx = center_x - gw/2;
+    int gy = center_y - gh/2;
+
+    // 边界检查
+    if(gx < 0) gx = 0;
+    if(gy < 0) gy = 0;
+    if(gx + gw > w) gw = w - gx;
+    if(gy + gh > h) gh = h - gy;
+    box[0] = gx; box[1] = gy; box[2] = gw; box[3] = gh;
+}
+
+// 解析 "宽,高 宽,高 ..." 形式的扩张倍数列表, 返回个数
+static int parse_expansions(const char* s, float (*out)[2], int max) {
+    int n = 0;
+    while (*s && n < max) {
+        char* end;
+        float ew = strtof(s, &end);
+        if (end == s || *end != ',') break;
+        s = end + 1;
+        float eh = strtof(s, &end);
+        if (end == s) break;
+        s = end;
+        while (*s == ' ' || *s == '\t') s++;
+        if (ew >= 1.0f && ew <= 4.0f && eh >= 1.0f && eh <= 4.0f) {
+            out[n][0] = ew;
+            out[n][1] = eh;
+            n++;
+        }
+    }
+    return n;
+}
+
+// 一辆车的子流水线任务; 每个任务只写自己的结果
+typedef struct {
+    Image frame;          // 整帧 (各级抠图都是它的视图)
+    Detection car;        // 车辆框; 只检测车牌模式下为车牌框
+    int has_vehicle;      // 0: 只检测车牌模式, 没有车辆框
+    int plate[4];         // 整帧定位已找到的车牌框 (未扩张, x, y, w, h); 宽为 0 时在车辆区域内定位
+    VehicleTrack* track;
+    int vehicle;          // 帧内序号
+    DetectionResult result;
+    int valid;
+    double stage_ms[2];   // [车牌定位, OCR] 耗时
+    int ocr_runs[3];      // 各级 OCR 推理次数
+} VehicleTask;
+
+// 一批帧的全部车辆任务 (可来自多路视频)
+typedef struct {
+    const AppConfig* cfg;
+    VehicleTask* tasks;
+} FrameJob;
+
+// 车辆区域 (x, y, w, h): 车辆框向四周扩张, 把车框边缘的车牌包进来
+static void vehicle_region(const Detection* car, int w, int h, int region[4]) {
+    // YOLO 原始坐标
+    int raw_cx = (int)car->x1;
+    int raw_cy = (int)car->y1;
+    int raw_cw = (int)(car->x2 - car->x1);
+    int raw_ch = (int)(car->y2 - car->y1);
+
+    // ========================================================
+    // 【核心修复 1】: 车辆框扩张 (ROI Expansion)
+    // 目的是把车牌（可能在车框边缘）给包进来
+    // ========================================================
+    int pad_w = (int)(raw_cw * 0.25f); // 宽度左右各扩 15%
+    int pad_h = (int)(raw_ch * 0.25f); // 高度上下各扩 15%
+
+    int cx = raw_cx - pad_w;
+    int cy = raw_cy - pad_h;
+    int cw = raw_cw + 2 * pad_w;
+    int ch = raw_ch + 2 * pad_h;
+
+    // 边界检查 (非常重要，否则抠图会崩)
+    if (cx < 0) cx = 0;
+    if (cy < 0) cy = 0;
+    if (cx + cw > w) cw = w - cx;
+    if (cy + ch > h) ch = h - cy;
+    region[0] = cx; region[1] = cy; region[2] = cw; region[3] = ch;
+}
+
+// 在车辆区域内定位车牌 (DBNet), 找到时 raw_box 为整帧坐标下的车牌框 (未扩张), 否则宽为 0
+static void locate_in_vehicle(const AppConfig* cfg, const Image* frame, const int region[4], int raw_box[4], int v) {
+    int cx = region[0], cy = region[1], cw = region[2], ch = region[3];
+    raw_box[2] = raw_box[3] = 0;
+
+    // 车辆区域直接作为整帧的视图, 预处理从原帧读取, 不复制像素
+    Image car_img = image_rect(frame, cx, cy, cw, ch);
+
+    // 车牌定位输入尺寸 (建议设为 640 以提高小目标检出率)
+    int det_size = cfg->det_size;
+    uint64_t ts = trace_begin();
+    void* p_in = malloc(1*3*det_size*det_size*(g_net_plate.input_u8 ? 1 : sizeof(float)));
+    if (g_net_plate.input_u8) preprocess_dbnet_u8(&car_img, det_size, p_in);
+    else preprocess_dbnet(&car_img, det_size, p_in);
+    trace_end(ts, "plate.preprocess", v);
+
+    float* p_out = NULL; size_t p_len = 0;
+
+    ts = trace_begin();
+    int p_ret = onnx_model_run_image(&g_net_plate, p_in, det_size, det_size, &p_out, &p_len);
+    trace_end(ts, "plate.infer", v);
+    if(p_ret == 0) {
+        // 从热力图中找车牌框
+        int px, py, pw, ph;
+        // 注意：这里是在“车辆小图”里找车牌
+        ts = trace_begin();
+        postprocess_dbnet(p_out, det_size, det_size, cfg->plate_threshold, &px, &py, &pw, &ph);
+        trace_end(ts, "plate.postprocess", v);
+
+        if(pw > 0 && ph > 0) {
+            // 坐标映射: 小图 -> 大图
+            float scale = fminf((float)det_size/cw, (float)det_size/ch);
+
+            // 【注意】这里的 cx, cy 必须是上面【扩张后】的车辆左上角
+            raw_box[0] = cx + (int)(px / scale);
+            raw_box[1] = cy + (int)(py / scale);
+            raw_box[2] = (int)(pw / scale);
+            raw_box[3] = (int)(ph / scale);
+        }
+        free(p_out);
+    }
+    free(p_in);
+}
+
+// 车牌框是否可信: 不能与车辆区域差不多宽 (防欺诈); 没有车辆框时不检查
+static int plate_fits(const int box[4], const int region[4]) {
+    return box[2] > 0 && box[3] > 0 && (region[2] == 0 || box[2] < region[2] * 0.9);
+}
+
+// 质量把关 -> 底色 -> 分级 OCR -> 校验, 填写任务结果; t_ocr 记录 OCR 开始时间
+static void recognize_plate(const AppConfig* cfg, VehicleTask* task, const int region[4], const int raw_box[4], double* t_ocr) {
+    const Image* frame = &task->frame;
+    int w = frame->width, h = frame->height;
+    const Detection* car = &task->car;
+    DetectionResult* r = &task->result;
+    int v = task->vehicle;
+
+    // ====================================================
+    // 【核心修复 2】: 车牌框二次扩张 (宽 1.8 倍, 高 2.0 倍)
+    // ====================================================
+    int box[4];
+    expand_plate_box(raw_box, 1.8f, 2.0f, w, h, box);
+    int gx = box[0], gy = box[1], gw = box[2], gh = box[3];
+    if (!plate_fits(box, region)) return;
+
+    // --- 车牌识别 (OCR Rec) ---
+    // 车牌区域同样是整帧的视图; 只有识别成功时才复制一份随结果输出
+    Image plate_image = image_rect(frame, gx, gy, gw, gh);
+
+    // OCR 前质量把关: 模糊/过曝的截图不识别;
+    // 同一辆车已有读数时, 只有画质明显更好的截图才重新识别;
+    // 轨迹中断/跳变后或距上次识别较久时复核, 防止后车沿用前车的轨迹而不被识别
+    uint64_t ts = trace_begin();
+    PlateQuality quality;
+    assess_plate_quality(&plate_image, &quality);
+    trace_end(ts, "plate.quality", v);
+    VehicleTrack* track = task->track;
+    int want_ocr = quality.score >= cfg->quality_min_score &&
+                   (!track || !track->has_reading || track->recheck ||
+                    track->last_frame - track->last_ocr >= TRACK_RECHECK_FRAMES ||
+                    quality.score > track->best_quality + cfg->quality_improve_margin);
+    if (!want_ocr) return;
+    if (track) {
+        track->recheck = 0;
+        track->last_ocr = track->last_frame;
+    }
+
+    *t_ocr = now_ms();
+    // 底色分类 (微秒级): 限定 OCR 字符集, 并供防欺诈比对号牌种类
+    ts = trace_begin();
+    PlateColorInfo color;
+    classify_plate_color(&plate_image, &color);
+    trace_end(ts, "plate.color", v);
+
+    // 分级识别: 快速识别足够可信 (通过规则校验且每个字符置信度达标) 即采用;
+    // 否则用完整模型, 仍不可信时换扩张倍数重新抠图再识别, 取最可信的读数
+    OcrReading reading, attempt;
+    int have = 0;
+    ONNXModel* fast_model = g_ocr_fast_loaded ? &g_net_ocr_fast : &g_net_ocr;
+    const OcrDict* fast_dict = g_fast_dict.keys ? &g_fast_dict : &g_dict;
+    int fast_w = cfg->cascade_fast_width, fast_h;
+    if (g_ocr_fast_loaded) onnx_model_fixed_hw(fast_model, &fast_h, &fast_w);
+    int cascade = cfg->cascade_enable;
+    if (cascade && (g_ocr_fast_loaded || fast_w < cfg->ocr_input_width)) {
+        ts = trace_begin();
+        have = ocr_read(fast_model, fast_dict, fast_w, &plate_image, color.color, &reading, v) == 0;
+        trace_end(ts, "ocr.fast", v);
+        task->ocr_runs[0]++;
+    }
+    if (!have || !ocr_accept(&reading, cfg->cascade_accept)) {
+        ts = trace_begin();
+        if (ocr_read(&g_net_ocr, &g_dict, cfg->ocr_input_width, &plate_image, color.color, &attempt, v) == 0 &&
+            (!have || ocr_better(&attempt, &reading))) {
+            reading = attempt;
+            have = 1;
+        }
+        trace_end(ts, "ocr.full", v);
+        task->ocr_runs[1]++;
+
+        float expansions[4][2];
+        int n_exp = cascade ? parse_expansions(cfg->cascade_recrop, expansions, 4) : 0;
+        for (int k = 0; k < n_exp && !(have && ocr_accept(&reading, cfg->cascade_accept)); k++) {
+            int alt[4];
+            expand_plate_box(raw_box, expansions[k][0], expansions[k][1], w, h, alt);
+            if (!plate_fits(alt, region)) continue;
+            ts = trace_begin();
+            Image alt_img = image_rect(frame, alt[0], alt[1], alt[2], alt[3]);
+            if (ocr_read(&g_net_ocr, &g_dict, cfg->ocr_input_width, &alt_img, color.color, &attempt, v) == 0 &&
+                (!have || ocr_better(&attempt, &reading))) {
+                // 采用新截图: 结果框、截图与防欺诈检查都以它为准
+                reading = attempt;
+                have = 1;
+                plate_image = alt_img;
+                gx = alt[0]; gy = alt[1]; gw = alt[2]; gh = alt[3];
             }
+            trace_end(ts, "ocr.recrop", v);
+            task->ocr_runs[2]++;
         }
-        last_index = max_idx;
     }
-    
-    // if (has_valid_char) {
-    //     printf("[OCR DEBUG] 原始索引序列: %s\n", debug_buf);
-    // } else {
-    //     printf("[OCR DEBUG] 模型认为全是空白 (Blank)\n");
-    // }
+    if (!have) return;
+    // 通过号牌规则但整体置信度太低的读数同样不采用 (按未识别处理)
+    if (reading.confidence < cfg->ocr_threshold) reading.valid = 0;
+
+    memset(r, 0, sizeof(DetectionResult));
+    r->confidence = car->confidence;
+    r->quality = quality.score;
+    r->plate_color = color.color;
+    r->color_confidence = color.confidence;
+    memcpy(r->vehicle_bbox, region, sizeof(r->vehicle_bbox));
+    r->plate_bbox[0] = gx;
+    r->plate_bbox[1] = gy;
+    r->plate_bbox[2] = gw;
+    r->plate_bbox[3] = gh;
+    r->is_fraud = 0;
+    r->ocr_confidence = reading.confidence;
+    memcpy(r->plate_text, reading.text, sizeof(reading.text));
+
+    if (reading.valid) {
+        if (track && track->has_reading && strcmp(track->reading, r->plate_text) == 0) {
+            // 同一辆车的复核: 画质明显更好时作为截图更新输出, 否则丢弃
+            if (quality.score <= track->best_quality + cfg->quality_improve_margin) return;
+            r->evidence_update = 1;
+        } else if (track) {
+            // 第一次读出, 或读数与轨迹上的不同 (已换了一辆车): 立即输出新事件
+            track->has_reading = 1;
+            memcpy(track->reading, r->plate_text, sizeof(track->reading));
+        }
+        if (track) track->best_quality = quality.score;
+
+        if (cfg->enable_anti_fraud) {
+            r->is_fraud = detect_fraud(&plate_image, r->plate_text,
+                                                    r->ocr_confidence, &color,
+                                                    r->fraud_reason);
+        }
+
+        // 白名单/黑名单匹配 (微秒级, 名单可随时替换)
+        PlateListMatch m;
+        if (plate_list_match(r->plate_text, cfg->list_max_edits, cfg->list_allow_max_edits, &m)) {
+            r->list_type = m.type;
+            r->list_distance = m.distance;
+            memcpy(r->list_plate, m.plate, sizeof(m.plate));
+        }
+
+        // 截图随结果交给调用方 (事件写盘), 不在处理线程落盘
+        r->plate_img = malloc((size_t)gw * gh * 3);
+        if (r->plate_img) image_copy(&plate_image, r->plate_img);
+        r->plate_img_w = gw;
+        r->plate_img_h = gh;
+        task->valid = 1;
+    } else if (strlen(r->plate_text) == 0) {
+        strcpy(r->plate_text, "无法识别");
+    }
 }
 
-DetectionResult* process_frame(unsigned char* img_data, int w, int h, int* count) {
-    *count = 0;
-    if(!img_data) return NULL;
-    
-    DetectionResult* results = calloc(5, sizeof(DetectionResult));
-    
+// 单辆车: 抠图 -> 车牌定位 (整帧定位模式下已完成) -> 质量把关 -> OCR -> 校验; 作为任务在线程池中执行
+static void process_vehicle(void* arg, int i) {
+    FrameJob* job = (FrameJob*)arg;
+    VehicleTask* task = &job->tasks[i];
+    const AppConfig* cfg = job->cfg;
+    double t_start = now_ms(), t_ocr = 0.0;
+
+    int region[4] = { 0, 0, 0, 0 };
+    if (task->has_vehicle) vehicle_region(&task->car, task->frame.width, task->frame.height, region);
+
+    int raw_box[4];
+    memcpy(raw_box, task->plate, sizeof(raw_box));
+    if (raw_box[2] <= 0 && task->has_vehicle) locate_in_vehicle(cfg, &task->frame, region, raw_box, task->vehicle);
+    if (raw_box[2] > 0 && raw_box[3] > 0) recognize_plate(cfg, task, region, raw_box, &t_ocr);
+
+    double t_end = now_ms();
+    task->stage_ms[0] = (t_ocr > 0.0 ? t_ocr : t_end) - t_start;
+    task->stage_ms[1] = t_ocr > 0.0 ? t_end - t_ocr : 0.0;
+}
+
+// --- 车牌定位方式 ---
+enum { PIPELINE_CASCADE = 0, PIPELINE_FRAME, PIPELINE_PLATE_ONLY };
+
+#define MAX_FRAME_PLATES 32
+#define FRAME_PLATE_MIN_PIXELS 20   // 整帧热力图中车牌很小, 噪点门限低于车辆小图
+
+static int pipeline_mode(const AppConfig* cfg) {
+    if (strcmp(cfg->pipeline_mode, "frame") == 0) return PIPELINE_FRAME;
+    if (strcmp(cfg->pipeline_mode, "plate_only") == 0) return PIPELINE_PLATE_ONLY;
+    return PIPELINE_CASCADE; // 其他取值在加载配置时已被拒绝
+}
+
+// 一帧车辆检测阶段的中间状态
+typedef struct {
+    int rx, ry, rw, rh, use_roi;
+    int yolo_w, yolo_h;
+    int done;
+    double t_start;
+    Detection vehicles[100];
+    VehicleTrack* tracks[100];
+    int n;
+    Detection plates[MAX_FRAME_PLATES]; // 整帧定位的车牌框 (整帧坐标, 未扩张), 按置信度降序
+    int plate_count;
+    int task_count;       // 本帧的子流水线任务数
+} FrameStage;
+
+// 车辆检测后处理: 坐标映射、区域过滤、NMS、尺寸过滤与跟踪关联 (跟踪表只在处理线程中修改)
+static void collect_vehicles(const AppConfig* cfg, FrameRequest* req, FrameStage* st, float* v_out, size_t v_len) {
+    Detection cars[100];
+    int car_cnt = 0;
+
+    // 后处理：置信度先放低一点，防止漏检
+    postprocess_yolo(v_out, v_len/85, cfg->threshold, st->yolo_w, st->yolo_h, st->rw, st->rh, cars, &car_cnt);
+
+    // 坐标映射回整帧, 丢弃底边中点 (车辆着地位置) 不在车道区域内的检测
+    if (st->use_roi) {
+        int kept = 0;
+        for (int i = 0; i < car_cnt; i++) {
+            Detection d = cars[i];
+            d.x1 += st->rx; d.x2 += st->rx;
+            d.y1 += st->ry; d.y2 += st->ry;
+            if (roi_contains(&cfg->roi, (d.x1 + d.x2) * 0.5f, d.y2)) cars[kept++] = d;
+        }
+        car_cnt = kept;
+    }
+
+    // NMS 去重
+    nms_yolo(cars, &car_cnt, cfg->nms_threshold);
+
+    // 过滤过小的误检
+    st->n = 0;
+    for (int i = 0; i < car_cnt; i++) {
+        if (cars[i].x2 - cars[i].x1 < 50 || cars[i].y2 - cars[i].y1 < 50) continue;
+        st->vehicles[st->n] = cars[i];
+        st->tracks[st->n] = track_vehicle(req->ctx, &cars[i]);
+        st->n++;
+    }
+}
+
+// 整帧定位: 在检测区域上只运行一次 DBNet, 每个连通区域一个车牌候选
+static int locate_frame_plates(const AppConfig* cfg, const FrameRequest* req, FrameStage* st) {
+    st->plate_count = 0;
+    int in_w, in_h;
+    if (!onnx_model_fixed_hw(&g_net_plate, &in_h, &in_w)) {
+        yolo_input_shape(st->rw, st->rh, cfg->frame_det_size, 0, &in_w, &in_h);
+    }
+
+    uint64_t ts = trace_begin();
+    Image frame = image_wrap(req->rgb, req->width, req->height);
+    Image roi_img = image_rect(&frame, st->rx, st->ry, st->rw, st->rh);
+    void* p_in = malloc((size_t)3*in_w*in_h*(g_net_plate.input_u8 ? 1 : sizeof(float)));
+    if (g_net_plate.input_u8) preprocess_dbnet_rect_u8(&roi_img, in_w, in_h, p_in);
+    else preprocess_dbnet_rect(&roi_img, in_w, in_h, p_in);
+    trace_end(ts, "plate.frame.preprocess", -1);
+
+    float* p_out = NULL; size_t p_len = 0;
+    ts = trace_begin();
+    int p_ret = onnx_model_run_image(&g_net_plate, p_in, in_h, in_w, &p_out, &p_len);
+    trace_end(ts, "plate.frame.infer", -1);
+    free(p_in);
+    if (p_ret != 0) return -1;
+    // 热力图与输入同尺寸
+    if (p_len < (size_t)in_w * in_h) {
+        free(p_out);
+        return -1;
+    }
+
+    ts = trace_begin();
+    Detection boxes[MAX_FRAME_PLATES];
+    int count = postprocess_dbnet_boxes(p_out, in_w, in_h, cfg->plate_threshold, FRAME_PLATE_MIN_PIXELS, boxes, MAX_FRAME_PLATES);
+    free(p_out);
+
+    // 映射回整帧; 丢弃明显不像单个号牌的文字区域 (竖排、过长的横幅) 与中心不在车道区域内的框
+    float scale = fminf((float)in_w/st->rw, (float)in_h/st->rh);
+    for (int i = 0; i < count; i++) {
+        Detection d = boxes[i];
+        d.x1 = st->rx + d.x1 / scale;
+        d.y1 = st->ry + d.y1 / scale;
+        d.x2 = st->rx + d.x2 / scale;
+        d.y2 = st->ry + d.y2 / scale;
+        float bw = d.x2 - d.x1, bh = d.y2 - d.y1;
+        if (bh <= 0 || bw < bh * 1.2f || bw > bh * 10.0f) continue;
+        if (!roi_contains(&cfg->roi, (d.x1 + d.x2) * 0.5f, (d.y1 + d.y2) * 0.5f)) continue;
+        st->plates[st->plate_count++] = d;
+    }
+    // 按置信度排序
+    nms_yolo(st->plates, &st->plate_count, 0.3f);
+    trace_end(ts, "plate.frame.postprocess", -1);
+    return 0;
+}
+
+// 把整帧定位的车牌分配给车辆: 车牌中心须落在车辆扩张区域内, 其中优先车牌水平居中且位于车身下半部的车辆,
+// 遮挡时前车的车牌不会分给后车. 每辆车最多一块车牌, 置信度高的车牌先分配;
+// 不在任何车辆内的车牌视为路牌、广告等文字丢弃. plate_of[i] 为车辆 i 的车牌序号, 没有为 -1
+static void assign_plates(const FrameStage* st, int w, int h, int* plate_of) {
+    for (int i = 0; i < st->n; i++) plate_of[i] = -1;
+    for (int p = 0; p < st->plate_count; p++) {
+        const Detection* pl = &st->plates[p];
+        float px = (pl->x1 + pl->x2) * 0.5f, py = (pl->y1 + pl->y2) * 0.5f;
+        int best = -1;
+        float best_cost = 0.0f;
+        for (int i = 0; i < st->n; i++) {
+            if (plate_of[i] >= 0) continue;
+            int region[4];
+            vehicle_region(&st->vehicles[i], w, h, region);
+            if (px < region[0] || px > region[0] + region[2] || py < region[1] || py > region[1] + region[3]) continue;
+            const Detection* car = &st->vehicles[i];
+            float cost = fabsf(px - (car->x1 + car->x2) * 0.5f) / (car->x2 - car->x1);
+            if (py < (car->y1 + car->y2) * 0.5f) cost += 1.0f;
+            // 同等条件下底边更靠下 (离镜头更近, 在前面) 的车优先
+            cost -= 0.1f * car->y2 / h;
+            if (best < 0 || cost < best_cost) { best = i; best_cost = cost; }
+        }
+        if (best >= 0) plate_of[best] = p;
+    }
+}
+
+static void plate_box_xywh(const Detection* d, int box[4]) {
+    box[0] = (int)d->x1;
+    box[1] = (int)d->y1;
+    box[2] = (int)(d->x2 - d->x1);
+    box[3] = (int)(d->y2 - d->y1);
+}
+
+int process_frames(FrameRequest* reqs, int n) {
+    // 本批使用的配置快照, 热加载在下一批生效
+    const AppConfig* cfg = config_acquire();
+    int max_det = cfg->max_detection_per_frame;
+    int mode = pipeline_mode(cfg);
+    FrameStage* stages = calloc(n, sizeof(FrameStage));
+
     // -----------------------------------------------------------
     // Step 1: 车辆检测 (YOLO)
     // -----------------------------------------------------------
-    float* v_in = malloc(1*3*640*640*sizeof(float));
-    
-    // 注意：preprocess_yolo 必须是保持比例的 resize (Letterbox)
-    // 此时 scale = min(640/w, 640/h)
-    preprocess_yolo(img_data, w, h, 640, v_in);
-    
-    int64_t v_shape[] = {1,3,640,640};
-    float* v_out = NULL; 
-    size_t v_len = 0;
+    for (int f = 0; f < n; f++) {
+        FrameRequest* req = &reqs[f];
+        FrameStage* st = &stages[f];
+        if (!req->ctx) req->ctx = &g_default_ctx;
+        req->results = NULL;
+        req->count = 0;
+        req->vehicle_count = 0;
+        req->status = 0;
+        memset(&req->ctx->last_timing, 0, sizeof(FrameTiming));
+        req->ctx->frame_no++;
+        st->t_start = now_ms();
+        if (!req->rgb) {
+            st->done = 1;
+            continue;
+        }
 
-    if(onnx_model_predict(&g_net_vehicle, v_in, v_shape, 4, &v_out, &v_len) == 0) {
-        Detection cars[100]; 
-        int car_cnt = 0;
-        
-        // 后处理：置信度先放低一点，防止漏检
-        postprocess_yolo(v_out, v_len/85, 0.25f, w, h, cars, &car_cnt); 
-        
-        // NMS 去重
-        nms_yolo(cars, &car_cnt, 0.45f);
-
-        // 遍历每一辆车
-        for(int i=0; i<car_cnt && *count < 5; i++) {
-            // YOLO 原始坐标
-            int raw_cx = (int)cars[i].x1;
-            int raw_cy = (int)cars[i].y1;
-            int raw_cw = (int)(cars[i].x2 - cars[i].x1);
-            int raw_ch = (int)(cars[i].y2 - cars[i].y1);
-
-            // 过滤过小的误检
-            if(raw_cw < 50 || raw_ch < 50) continue;
-
-            // ========================================================
-            // 【核心修复 1】: 车辆框扩张 (ROI Expansion)
-            // 目的是把车牌（可能在车框边缘）给包进来
-            // ========================================================
-            int pad_w = (int)(raw_cw * 0.25f); // 宽度左右各扩 15%
-            int pad_h = (int)(raw_ch * 0.25f); // 高度上下各扩 15%
-
-            int cx = raw_cx - pad_w;
-            int cy = raw_cy - pad_h;
-            int cw = raw_cw + 2 * pad_w;
-            int ch = raw_ch + 2 * pad_h;
-
-            // 边界检查 (非常重要，否则抠图会崩)
-            if (cx < 0) cx = 0;
-            if (cy < 0) cy = 0;
-            if (cx + cw > w) cw = w - cx;
-            if (cy + ch > h) ch = h - cy;
-            
-            // 打印修正后的车辆坐标，用于调试
-            // printf("[DEBUG] 车辆 #%d 修正坐标: x=%d y=%d w=%d h=%d\n", i, cx, cy, cw, ch);
-
-            // ========================================================
-            // Step 2: 车辆抠图 & 车牌定位 (DBNet)
-            // ========================================================
-            unsigned char* car_img = malloc(cw * ch * 3);
-            crop_image_rgb(img_data, w, h, cx, cy, cw, ch, car_img);
-
-            // 保存图 完整车牌
-            // char debug_name[64];
-            // snprintf(debug_name, 64, "debug_car_%d.ppm", i);
-            // save_plate_debug(debug_name, car_img, cw, ch);
-
-            // 车牌定位输入尺寸 (建议设为 640 以提高小目标检出率)
-            int det_size = 640; 
-            float* p_in = malloc(1*3*det_size*det_size*sizeof(float));
-            preprocess_dbnet(car_img, cw, ch, det_size, p_in);
-            
-            int64_t p_shape[] = {1,3,det_size,det_size};
-            float* p_out = NULL; size_t p_len = 0;
-            
-            if(onnx_model_predict(&g_net_plate, p_in, p_shape, 4, &p_out, &p_len) == 0) {
-                // 2.1 从热力图中找车牌框
-                int px, py, pw, ph;
-                // 注意：这里是在“车辆小图”里找车牌
-                postprocess_dbnet(p_out, det_size, det_size, 0.3f, &px, &py, &pw, &ph);
-                
-                if(pw > 0 && ph > 0) {
-                    // 2.2 坐标映射: 小图 -> 大图
-                    float scale = fminf((float)det_size/cw, (float)det_size/ch);
-                    
-                    // 【注意】这里的 cx, cy 必须是上面【扩张后】的车辆左上角
-                    int gx = cx + (int)(px / scale);
-                    int gy = cy + (int)(py / scale);
-                    int gw = (int)(pw / scale);
-                    int gh = (int)(ph / scale);
-                    
-                    // ====================================================
-                    // 【核心修复 2】: 车牌框二次扩张
-                    // DBNet 找出的框是收缩的(Shrunk)，必须放大才能包含完整文字
-                    // ====================================================
-                    float plate_expand_w = 1.8f; // 宽扩 1.2 倍
-                    float plate_expand_h = 2.0f; // 高扩 1.5 倍
-
-                    int center_x = gx + gw/2;
-                    int center_y = gy + gh/2;
-                    int new_gw = (int)(gw * plate_expand_w);
-                    int new_gh = (int)(gh * plate_expand_h);
-                    
-                    gx = center_x - new_gw/2;
-                    gy = center_y - new_gh/2;
-                    gw = new_gw;
-                    gh = new_gh;
-
-                    // 边界检查
-                    if(gx < 0) gx = 0;
-                    if(gy < 0) gy = 0;
-                    if(gx + gw > w) gw = w - gx;
-                    if(gy + gh > h) gh = h - gy;
-
-                    // ====================================================
-
-                    // 防欺诈逻辑
-                    if (gw < cw * 0.9) {
-                        // --- Step 3: 车牌识别 (OCR Rec) ---
-                        unsigned char* plate_img = malloc(gw * gh * 3);
-                        crop_image_rgb(img_data, w, h, gx, gy, gw, gh, plate_img);
-                        
-                        // 保存最终车牌图，用于确认
-                        // snprintf(debug_name, 64, "debug_plate_%d.ppm", i);
-                        // save_plate_debug(debug_name, plate_img, gw, gh);
-
-                        float* ocr_in = malloc(1*3*48*320*sizeof(float));
-                        preprocess_ocr(plate_img, gw, gh, ocr_in);
-                        
-                        int64_t ocr_shape[] = {1,3,48,320};
-                        float* ocr_out = NULL; size_t ocr_len = 0;
-                        
-                        if(onnx_model_predict(&g_net_ocr, ocr_in, ocr_shape, 4, &ocr_out, &ocr_len) == 0) {
-                            results[*count].confidence = cars[i].confidence;
-                            results[*count].vehicle_bbox[0] = cx;
-                            results[*count].vehicle_bbox[1] = cy;
-                            results[*count].vehicle_bbox[2] = cw;
-                            results[*count].vehicle_bbox[3] = ch;
-                            results[*count].is_fraud = 0;
-                            
-                            // 3.3 真实解码
-                            int model_num_classes = 6625; 
-                            if (ocr_len % 6625 == 0) model_num_classes = 6625;
-                            else if (ocr_len % 97 == 0) model_num_classes = 97;
-                            
-                            int seq_len = ocr_len / model_num_classes;
-                            
-                            decode_ocr_real(ocr_out, seq_len, model_num_classes, results[*count].plate_text);
-
-                            // 去除点号
-                            clean_plate_text(results[*count].plate_text);
-
-                            // 混淆修正
-                            optimize_char_confusion(results[*count].plate_text);
-
-                            // 强规则校验和清洗
-                            int is_valid = fix_and_validate_plate(results[*count].plate_text);
-                            
-                            if (is_valid) {
-                                (*count)++;
-                            } else { 
-
-                            }
-                            
-                            if (strlen(results[*count].plate_text) == 0) {
-                                strcpy(results[*count].plate_text, "无法识别");
-                            }
-
-                            free(ocr_out);
-                        }
-                        
-                        free(ocr_in);
-                        free(plate_img);
-                    }
-                }
-                free(p_out);
+        // 只把车道检测区域的外接矩形送入检测: 同样的输入尺寸下车辆/车牌的有效分辨率更高
+        st->use_roi = roi_bounds(&cfg->roi, req->width, req->height, &st->rx, &st->ry, &st->rw, &st->rh);
+        // 只检测车牌时跳过车辆检测
+        if (mode == PIPELINE_PLATE_ONLY) {
+            st->done = 1;
+            continue;
+        }
+
+        // 输入尺寸: 固定尺寸导出的模型用模型自身的宽高, 动态轴模型按画面宽高比取矩形, 避免大面积补零
+        if (!onnx_model_fixed_hw(&g_net_vehicle, &st->yolo_h, &st->yolo_w)) {
+            yolo_input_shape(st->rw, st->rh, cfg->yolo_input_size, cfg->yolo_input_height, &st->yolo_w, &st->yolo_h);
+        }
+    }
+
+    // 输入尺寸相同的帧合成一个批次推理 (模型批次维度为动态时), 否则逐帧推理
+    int dynamic_batch = onnx_model_dynamic_batch(&g_net_vehicle);
+    int* group = malloc(n * sizeof(int));
+    for (int f = 0; f < n; f++) {
+        if (stages[f].done) continue;
+        int g = 0;
+        for (int k = f; k < n; k++) {
+            if (stages[k].done || stages[k].yolo_w != stages[f].yolo_w || stages[k].yolo_h != stages[f].yolo_h) continue;
+            if (g > 0 && !dynamic_batch) break;
+            group[g++] = k;
+            stages[k].done = 1;
+        }
+
+        int yolo_w = stages[f].yolo_w, yolo_h = stages[f].yolo_h;
+        // uint8 NHWC 模型只需缩放, 输入张量为 float 的 1/4
+        size_t per_input = (size_t)3*yolo_w*yolo_h*(g_net_vehicle.input_u8 ? 1 : sizeof(float));
+        unsigned char* v_in = malloc(per_input * g);
+        for (int m = 0; m < g; m++) {
+            FrameRequest* req = &reqs[group[m]];
+            FrameStage* st = &stages[group[m]];
+            uint64_t ts = trace_begin();
+            // 检测区域是整帧的视图 (未配置时即整帧)
+            Image frame = image_wrap(req->rgb, req->width, req->height);
+            Image roi_img = image_rect(&frame, st->rx, st->ry, st->rw, st->rh);
+
+            // 注意：preprocess_yolo 必须是保持比例的 resize (Letterbox)
+            // 此时 scale = min(yolo_w/rw, yolo_h/rh)
+            void* dst = v_in + per_input * m;
+            if (g_net_vehicle.input_u8) preprocess_yolo_u8(&roi_img, yolo_w, yolo_h, dst);
+            else preprocess_yolo(&roi_img, yolo_w, yolo_h, dst);
+            trace_end(ts, "vehicle.preprocess", -1);
+            req->ctx->last_timing.vehicle_pre_ms = now_ms() - st->t_start;
+        }
+
+        float* v_out = NULL;
+        size_t v_len = 0;
+
+        double t_infer = now_ms();
+        uint64_t ts = trace_begin();
+        int v_ret = onnx_model_run_batch(&g_net_vehicle, v_in, g, yolo_h, yolo_w, &v_out, &v_len);
+        trace_end(ts, "vehicle.infer", -1);
+        if(v_ret == 0) {
+            size_t per_output = v_len / g;
+            for (int m = 0; m < g; m++) {
+                ts = trace_begin();
+                collect_vehicles(cfg, &reqs[group[m]], &stages[group[m]], v_out + per_output * m, per_output);
+                trace_end(ts, "vehicle.postprocess", -1);
+                reqs[group[m]].ctx->last_timing.vehicle_infer_ms = now_ms() - t_infer;
+            }
+            free(v_out);
+        } else {
+            for (int m = 0; m < g; m++) reqs[group[m]].status = -1;
+        }
+        free(v_in);
+    }
+    free(group);
+
+    // 整帧定位: 每帧只运行一次车牌定位, 耗时与车辆数无关; 整帧模式下没有车辆的帧无需定位
+    if (mode != PIPELINE_CASCADE) {
+        for (int f = 0; f < n; f++) {
+            if (!reqs[f].rgb || (mode == PIPELINE_FRAME && stages[f].n == 0)) continue;
+            double t_plate = now_ms();
+            if (locate_frame_plates(cfg, &reqs[f], &stages[f]) != 0) reqs[f].status = -1;
+            reqs[f].ctx->last_timing.plate_frame_ms = now_ms() - t_plate;
+        }
+    }
+
+    // -----------------------------------------------------------
+    // Step 2: 每辆车的子流水线作为任务并行执行 (各帧的车辆放进同一批):
+    // B 车的抠图/预处理与 A 车的推理重叠.
+    // 整帧定位时只有分到车牌的车辆才有任务; 只检测车牌时每块车牌一个任务 (按车牌框跟踪)
+    // -----------------------------------------------------------
+    int total = 0;
+    for (int f = 0; f < n; f++) total += mode == PIPELINE_PLATE_ONLY ? stages[f].plate_count : stages[f].n;
+    VehicleTask* tasks = calloc(total > 0 ? total : 1, sizeof(VehicleTask));
+    int t = 0;
+    for (int f = 0; f < n; f++) {
+        FrameStage* st = &stages[f];
+        Image frame = image_wrap(reqs[f].rgb, reqs[f].width, reqs[f].height);
+        int first = t;
+        if (mode == PIPELINE_PLATE_ONLY) {
+            for (int p = 0; p < st->plate_count; p++, t++) {
+                tasks[t].frame = frame;
+                tasks[t].car = st->plates[p];
+                tasks[t].track = track_vehicle(reqs[f].ctx, &st->plates[p]);
+                plate_box_xywh(&st->plates[p], tasks[t].plate);
+                tasks[t].vehicle = p;
+            }
+        } else {
+            int plate_of[100];
+            if (mode == PIPELINE_FRAME) assign_plates(st, reqs[f].width, reqs[f].height, plate_of);
+            for (int i = 0; i < st->n; i++) {
+                if (mode == PIPELINE_FRAME && plate_of[i] < 0) continue;
+                tasks[t].frame = frame;
+                tasks[t].car = st->vehicles[i];
+                tasks[t].has_vehicle = 1;
+                tasks[t].track = st->tracks[i];
+                if (mode == PIPELINE_FRAME) plate_box_xywh(&st->plates[plate_of[i]], tasks[t].plate);
+                tasks[t].vehicle = i;
+                t++;
             }
-            free(p_in);
-            free(car_img);
         }
-        free(v_out);
+        st->task_count = t - first;
     }
-    free(v_in);
-    return results;
-}
\ No newline at end of file
+    FrameJob job = { cfg, tasks };
+    double t_vehicles = now_ms();
+    uint64_t ts = trace_begin();
+    task_pool_run(g_vehicle_pool, process_vehicle, &job, t);
+    trace_end(ts, "vehicles", -1);
+    double vehicles_ms = now_ms() - t_vehicles;
+
+    // 按检测顺序收集结果
+    t = 0;
+    for (int f = 0; f < n; f++) {
+        FrameRequest* req = &reqs[f];
+        FrameTiming* timing = &req->ctx->last_timing;
+        // 只检测车牌时以定位到的车牌数代替车辆数 (判断车道是否活跃)
+        int seen = mode == PIPELINE_PLATE_ONLY ? stages[f].plate_count : stages[f].n;
+        req->results = calloc(max_det, sizeof(DetectionResult));
+        req->vehicle_count = seen;
+        req->ctx->last_vehicle_count = seen;
+        timing->vehicles = seen;
+        timing->vehicles_ms = vehicles_ms;
+        for (int i = 0; i < stages[f].task_count; i++, t++) {
+            timing->plate_ms += tasks[t].stage_ms[0];
+            timing->ocr_ms += tasks[t].stage_ms[1];
+            for (int k = 0; k < 3; k++) timing->ocr_runs[k] += tasks[t].ocr_runs[k];
+            if (tasks[t].valid && req->count < max_det) {
+                tasks[t].result.frame_ts_us = req->timestamp_us;
+                req->results[req->count++] = tasks[t].result;
+            } else {
+                free(tasks[t].result.plate_img);
+            }
+        }
+        timing->total_ms = now_ms() - stages[f].t_start;
+    }
+    free(tasks);
+    free(stages);
+    config_release(cfg);
+    int ret = 0;
+    for (int f = 0; f < n; f++) {
+        if (reqs[f].status != 0) ret = -1;
+    }
+    return ret;
+}
+
+DetectionResult* process_frame(unsigned char* img_data, int w, int h, uint64_t timestamp_us, int* count) {
+    FrameRequest req = { img_data, w, h, timestamp_us, &g_default_ctx, NULL, 0, 0, 0 };
+    process_frames(&req, 1);
+    *count = req.count;
+    if (!img_data) {
+        free(req.results);
+        return NULL;
+    }
+    return req.results;
+}
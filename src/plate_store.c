@@ -0,0 +1,633 @@
+// 车牌事件存储 (分段追加写 + mmap 排序索引)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "include/plate_store.h"
+
+#define KEY_SIZE 16
+#define IDX_MAGIC 0x58494C50u  // "PLIX"
+#define IDX_VERSION 1
+
+// 索引项: 按 (key, ts) 升序
+typedef struct {
+    char key[KEY_SIZE];
+    int64_t ts;
+    uint32_t rec;      // 段内记录序号
+    uint32_t reserved;
+} IndexEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t first_id;  // 合并段覆盖的段号范围 [first_id, last_id]
+    uint32_t last_id;
+    uint64_t count;
+    int64_t min_ts;
+    int64_t max_ts;
+} IndexHeader;
+
+// 已封存的只读段
+typedef struct {
+    uint32_t id, last_id;
+    uint32_t count;
+    int64_t min_ts, max_ts;
+    const PlateRecord* recs;  // mmap 的 .dat
+    size_t recs_len;
+    void* idx_map;            // mmap 的 .idx (含文件头)
+    size_t idx_len;
+    IndexEntry* idx_heap;     // 只读打开且索引不可用时, 由 .dat 在内存中建立的索引
+    const IndexEntry* idx;
+} Segment;
+
+struct PlateStore {
+    PlateStoreConfig cfg;
+    pthread_rwlock_t lock;
+
+    Segment* segs;       // 按段号升序
+    int nsegs, cap;
+
+    // 活动段: 记录同时保存在内存, 查询时线性扫描
+    uint32_t active_id;
+    int active_fd;
+    PlateRecord* active_recs;
+    char (*active_keys)[KEY_SIZE];  // 归一化后的键, 避免查询时重复计算
+    int active_count;
+    int64_t active_min_ts, active_max_ts;
+};
+
+void plate_store_normalize(const char* plate, char* key, int key_size) {
+    int n = 0;
+    for (const unsigned char* p = (const unsigned char*)plate; *p && n < key_size - 1; p++) {
+        if (p[0] == 0xC2 && p[1] == 0xB7) { p++; continue; } // '·'
+        if (*p == '.' || *p == '-' || *p == ' ') continue;
+        key[n++] = (char)toupper(*p);
+    }
+    // UTF-8 截断保护: 不留下半个汉字
+    while (n > 0 && ((unsigned char)key[n - 1] & 0xC0) == 0x80) {
+        int start = n - 1;
+        while (start > 0 && ((unsigned char)key[start] & 0xC0) == 0x80) start--;
+        int need = ((unsigned char)key[start] >= 0xF0) ? 4 : ((unsigned char)key[start] >= 0xE0) ? 3 : 2;
+        if (n - start >= need) break;
+        n = start;
+    }
+    memset(key + n, 0, key_size - n);
+}
+
+static void seg_path(const PlateStore* s, uint32_t id, const char* ext, char* out, size_t size) {
+    snprintf(out, size, "%s/seg_%08u.%s", s->cfg.dir, id, ext);
+}
+
+static int cmp_entry(const void* a, const void* b) {
+    const IndexEntry* x = a;
+    const IndexEntry* y = b;
+    int c = memcmp(x->key, y->key, KEY_SIZE);
+    if (c) return c;
+    return (x->ts > y->ts) - (x->ts < y->ts);
+}
+
+static void* map_file(const char* path, size_t* len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void* p = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) p = NULL;
+        else *len = st.st_size;
+    }
+    close(fd);
+    return p;
+}
+
+static void seg_unmap(Segment* g) {
+    if (g->recs) munmap((void*)g->recs, g->recs_len);
+    if (g->idx_map) munmap(g->idx_map, g->idx_len);
+    free(g->idx_heap);
+    g->recs = NULL;
+    g->idx_map = NULL;
+    g->idx_heap = NULL;
+}
+
+static int write_all(int fd, const void* buf, size_t len) {
+    const char* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// 为记录数组建立排序索引项, 同时填写头部的时间范围
+static void build_index(const PlateRecord* recs, uint32_t count, IndexEntry* e, IndexHeader* h) {
+    for (uint32_t i = 0; i < count; i++) {
+        plate_store_normalize(recs[i].plate_text, e[i].key, KEY_SIZE);
+        e[i].ts = recs[i].wall_time_us;
+        e[i].rec = i;
+        e[i].reserved = 0;
+        if (e[i].ts < h->min_ts) h->min_ts = e[i].ts;
+        if (e[i].ts > h->max_ts) h->max_ts = e[i].ts;
+    }
+    qsort(e, count, sizeof(IndexEntry), cmp_entry);
+}
+
+// 为记录数组建立排序索引并写入 path (先写临时文件再 rename)
+static int write_index(const char* path, const PlateRecord* recs, uint32_t count,
+                       uint32_t first_id, uint32_t last_id) {
+    IndexEntry* e = malloc((size_t)(count ? count : 1) * sizeof(IndexEntry));
+    if (!e) return -1;
+    IndexHeader h = { IDX_MAGIC, IDX_VERSION, first_id, last_id, count, INT64_MAX, INT64_MIN };
+    build_index(recs, count, e, &h);
+
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int ret = -1;
+    if (fd >= 0) {
+        if (write_all(fd, &h, sizeof(h)) == 0 &&
+            write_all(fd, e, (size_t)count * sizeof(IndexEntry)) == 0 &&
+            fsync(fd) == 0) ret = 0;
+        close(fd);
+        if (ret == 0 && rename(tmp, path) != 0) ret = -1;
+        if (ret != 0) unlink(tmp);
+    }
+    free(e);
+    return ret;
+}
+
+// 加载已封存的段 (索引缺失或损坏时由 .dat 重建)
+static int seg_load(PlateStore* s, uint32_t id, Segment* g) {
+    char dat[300], idx[300];
+    seg_path(s, id, "dat", dat, sizeof(dat));
+    seg_path(s, id, "idx", idx, sizeof(idx));
+    memset(g, 0, sizeof(*g));
+    g->id = g->last_id = id;
+
+    g->recs = map_file(dat, &g->recs_len);
+    if (!g->recs) return -1;
+    uint32_t count = g->recs_len / sizeof(PlateRecord);
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        g->idx_map = map_file(idx, &g->idx_len);
+        if (g->idx_map && g->idx_len >= sizeof(IndexHeader)) {
+            const IndexHeader* h = g->idx_map;
+            if (h->magic == IDX_MAGIC && h->version == IDX_VERSION && h->count == count &&
+                g->idx_len == sizeof(IndexHeader) + count * sizeof(IndexEntry)) {
+                g->count = count;
+                g->last_id = h->last_id;
+                g->min_ts = h->min_ts;
+                g->max_ts = h->max_ts;
+                g->idx = (const IndexEntry*)(h + 1);
+                return 0;
+            }
+        }
+        if (g->idx_map) munmap(g->idx_map, g->idx_len);
+        g->idx_map = NULL;
+        if (attempt == 0 && !s->cfg.read_only) {
+            printf("[Store] 重建索引 %s\n", idx);
+            if (write_index(idx, g->recs, count, id, id) != 0) break;
+        }
+    }
+    seg_unmap(g);
+    return -1;
+}
+
+// 只读打开时索引与数据不符 (写进程正在合并, 两次 rename 之间) 不能重建索引文件:
+// 直接由 .dat 在内存中建立索引, 该段按原段号单独查询, 结果仍然完整
+static int seg_load_scan(PlateStore* s, uint32_t id, Segment* g) {
+    char dat[300];
+    seg_path(s, id, "dat", dat, sizeof(dat));
+    memset(g, 0, sizeof(*g));
+    g->id = g->last_id = id;
+    g->recs = map_file(dat, &g->recs_len);
+    if (!g->recs) return -1;
+    uint32_t count = g->recs_len / sizeof(PlateRecord);
+    g->idx_heap = malloc((size_t)(count ? count : 1) * sizeof(IndexEntry));
+    if (!g->idx_heap) {
+        seg_unmap(g);
+        return -1;
+    }
+    IndexHeader h = { IDX_MAGIC, IDX_VERSION, id, id, count, INT64_MAX, INT64_MIN };
+    build_index(g->recs, count, g->idx_heap, &h);
+    g->count = count;
+    g->min_ts = h.min_ts;
+    g->max_ts = h.max_ts;
+    g->idx = g->idx_heap;
+    return 0;
+}
+
+static int segs_push(PlateStore* s, const Segment* g) {
+    if (s->nsegs == s->cap) {
+        int cap = s->cap ? s->cap * 2 : 16;
+        Segment* n = realloc(s->segs, cap * sizeof(Segment));
+        if (!n) return -1;
+        s->segs = n;
+        s->cap = cap;
+    }
+    s->segs[s->nsegs++] = *g;
+    return 0;
+}
+
+static int open_active(PlateStore* s, uint32_t id) {
+    char dat[300];
+    seg_path(s, id, "dat", dat, sizeof(dat));
+    s->active_fd = open(dat, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (s->active_fd < 0) {
+        printf("[Store] 无法创建 %s: %s\n", dat, strerror(errno));
+        return -1;
+    }
+    s->active_id = id;
+    s->active_count = 0;
+    s->active_min_ts = INT64_MAX;
+    s->active_max_ts = INT64_MIN;
+    return 0;
+}
+
+// 封存活动段: 生成索引, 切换为 mmap 只读段, 开启新的活动段
+static int seal_active(PlateStore* s) {
+    if (s->active_count == 0) return 0;
+    close(s->active_fd);
+    s->active_fd = -1;
+
+    char idx[300];
+    seg_path(s, s->active_id, "idx", idx, sizeof(idx));
+    write_index(idx, s->active_recs, s->active_count, s->active_id, s->active_id);
+
+    Segment g;
+    int loaded = seg_load(s, s->active_id, &g);
+
+    pthread_rwlock_wrlock(&s->lock);
+    if (loaded == 0) segs_push(s, &g);
+    uint32_t next = s->active_id + 1;
+    s->active_count = 0;
+    pthread_rwlock_unlock(&s->lock);
+
+    return open_active(s, next);
+}
+
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void load_active_readonly(PlateStore* s, const char* dat) {
+    FILE* f = fopen(dat, "rb");
+    if (!f) return;
+    while (s->active_count < s->cfg.segment_records &&
+           fread(&s->active_recs[s->active_count], sizeof(PlateRecord), 1, f) == 1) {
+        const PlateRecord* r = &s->active_recs[s->active_count];
+        plate_store_normalize(r->plate_text, s->active_keys[s->active_count], KEY_SIZE);
+        if (r->wall_time_us < s->active_min_ts) s->active_min_ts = r->wall_time_us;
+        if (r->wall_time_us > s->active_max_ts) s->active_max_ts = r->wall_time_us;
+        s->active_count++;
+    }
+    fclose(f);
+}
+
+PlateStore* plate_store_open(const PlateStoreConfig* cfg) {
+    PlateStore* s = calloc(1, sizeof(PlateStore));
+    if (!s) return NULL;
+    s->cfg = *cfg;
+    if (s->cfg.segment_records < 1024) s->cfg.segment_records = 1024;
+    if (s->cfg.merge_records < s->cfg.segment_records) s->cfg.merge_records = s->cfg.segment_records;
+    pthread_rwlock_init(&s->lock, NULL);
+    s->active_fd = -1;
+    s->active_min_ts = INT64_MAX;
+    s->active_max_ts = INT64_MIN;
+    s->active_recs = malloc((size_t)s->cfg.segment_records * sizeof(PlateRecord));
+    s->active_keys = malloc((size_t)s->cfg.segment_records * KEY_SIZE);
+    if (!s->cfg.read_only) mkdir(s->cfg.dir, 0755);
+
+    // 扫描已有的段
+    uint32_t* ids = NULL;
+    int nids = 0, cap = 0;
+    DIR* d = opendir(s->cfg.dir);
+    if (!d || !s->active_recs || !s->active_keys) {
+        printf("[Store] 无法打开存储目录 %s\n", s->cfg.dir);
+        if (d) closedir(d);
+        plate_store_close(s);
+        return NULL;
+    }
+    struct dirent* de;
+    while ((de = readdir(d)) != NULL) {
+        unsigned id;
+        char tail[8];
+        if (sscanf(de->d_name, "seg_%8u.%7s", &id, tail) == 2 && strcmp(tail, "dat") == 0) {
+            if (nids == cap) {
+                cap = cap ? cap * 2 : 64;
+                uint32_t* n = realloc(ids, cap * sizeof(uint32_t));
+                if (!n) break;
+                ids = n;
+            }
+            ids[nids++] = id;
+        }
+    }
+    closedir(d);
+    qsort(ids, nids, sizeof(uint32_t), cmp_u32);
+
+    uint32_t next_id = 1;
+    uint32_t covered = 0;
+    for (int i = 0; i < nids; i++) {
+        char dat[300], idx[300];
+        seg_path(s, ids[i], "dat", dat, sizeof(dat));
+        seg_path(s, ids[i], "idx", idx, sizeof(idx));
+        if (ids[i] <= covered) {
+            // 合并过程中断留下的旧段, 其内容已在合并段中
+            if (!s->cfg.read_only) {
+                unlink(dat);
+                unlink(idx);
+            }
+            continue;
+        }
+        Segment g;
+        if (seg_load(s, ids[i], &g) == 0) {
+            segs_push(s, &g);
+            covered = g.last_id;
+        } else if (s->cfg.read_only && i == nids - 1) {
+            // 只读打开时, 写进程的活动段还没有索引, 读入内存线性扫描
+            load_active_readonly(s, dat);
+        } else if (s->cfg.read_only && seg_load_scan(s, ids[i], &g) == 0) {
+            printf("[Store] %s 与数据不符 (可能正在合并), 按数据文件建立临时索引\n", idx);
+            segs_push(s, &g);
+            covered = g.last_id;
+        } else {
+            printf("[Store] 跳过无法读取的段 %s, 查询结果将不含其中的记录\n", dat);
+        }
+        next_id = ids[i] + 1;
+        if (covered >= next_id) next_id = covered + 1;
+    }
+    free(ids);
+
+    if (!s->cfg.read_only && open_active(s, next_id) != 0) {
+        plate_store_close(s);
+        return NULL;
+    }
+    unsigned long total = 0;
+    for (int i = 0; i < s->nsegs; i++) total += s->segs[i].count;
+    printf("[Store] %s: %d 段, %lu 条记录\n", s->cfg.dir, s->nsegs, total);
+    return s;
+}
+
+void plate_store_close(PlateStore* s) {
+    if (!s) return;
+    // 活动段封存, 下次启动直接 mmap
+    if (s->active_fd >= 0) {
+        if (s->active_count > 0) seal_active(s);
+        if (s->active_fd >= 0) {
+            close(s->active_fd);
+            // 空的活动段文件无需保留
+            char dat[300];
+            seg_path(s, s->active_id, "dat", dat, sizeof(dat));
+            struct stat st;
+            if (stat(dat, &st) == 0 && st.st_size == 0) unlink(dat);
+        }
+    }
+    for (int i = 0; i < s->nsegs; i++) seg_unmap(&s->segs[i]);
+    free(s->segs);
+    free(s->active_recs);
+    free(s->active_keys);
+    pthread_rwlock_destroy(&s->lock);
+    free(s);
+}
+
+int plate_store_append(PlateStore* s, const PlateRecord* rec) {
+    if (s->cfg.read_only) return -1;
+    // 段内记录必须按时间有序 (时间查询依赖二分); 时钟回拨时提前封存
+    if (s->active_count > 0 && rec->wall_time_us < s->active_max_ts) seal_active(s);
+    if (s->active_count >= s->cfg.segment_records) seal_active(s);
+    if (s->active_fd < 0) return -1;
+
+    if (write_all(s->active_fd, rec, sizeof(*rec)) != 0) return -1;
+
+    char key[KEY_SIZE];
+    plate_store_normalize(rec->plate_text, key, KEY_SIZE);
+
+    pthread_rwlock_wrlock(&s->lock);
+    memcpy(s->active_keys[s->active_count], key, KEY_SIZE);
+    s->active_recs[s->active_count++] = *rec;
+    if (rec->wall_time_us < s->active_min_ts) s->active_min_ts = rec->wall_time_us;
+    if (rec->wall_time_us > s->active_max_ts) s->active_max_ts = rec->wall_time_us;
+    pthread_rwlock_unlock(&s->lock);
+    return 0;
+}
+
+// --- 查询 ---
+
+typedef struct {
+    PlateRecord* out;
+    int max_out;
+    int n;
+} QueryResult;
+
+static void result_add(QueryResult* q, const PlateRecord* r) {
+    if (q->n < q->max_out) {
+        q->out[q->n++] = *r;
+        return;
+    }
+    // 已满: 替换其中最旧的一条 (结果集很小, 线性查找即可)
+    int oldest = 0;
+    for (int i = 1; i < q->n; i++)
+        if (q->out[i].wall_time_us < q->out[oldest].wall_time_us) oldest = i;
+    if (r->wall_time_us > q->out[oldest].wall_time_us) q->out[oldest] = *r;
+}
+
+static int64_t result_oldest(const QueryResult* q) {
+    if (q->n < q->max_out) return INT64_MIN;
+    int64_t t = INT64_MAX;
+    for (int i = 0; i < q->n; i++)
+        if (q->out[i].wall_time_us < t) t = q->out[i].wall_time_us;
+    return t;
+}
+
+// 索引中第一个 >= (key, ts) 的位置
+static uint32_t idx_lower_bound(const IndexEntry* e, uint32_t n, const char* key, int key_len) {
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (memcmp(e[mid].key, key, key_len) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// 记录中第一个 ts >= t 的位置 (段内按时间有序)
+static uint32_t rec_lower_bound(const PlateRecord* r, uint32_t n, int64_t t) {
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (r[mid].wall_time_us < t) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void query_segment(const Segment* g, const char* key, int key_len,
+                          int64_t from, int64_t to, QueryResult* q) {
+    if (key_len == 0) {
+        // 纯时间查询: 从区间末尾向前取, 结果集满即停止
+        uint32_t end = rec_lower_bound(g->recs, g->count, to == INT64_MAX ? to : to + 1);
+        uint32_t begin = rec_lower_bound(g->recs, g->count, from);
+        for (uint32_t i = end; i > begin; i--) {
+            if (q->n >= q->max_out && g->recs[i - 1].wall_time_us <= result_oldest(q)) break;
+            result_add(q, &g->recs[i - 1]);
+        }
+        return;
+    }
+    for (uint32_t i = idx_lower_bound(g->idx, g->count, key, key_len);
+         i < g->count && memcmp(g->idx[i].key, key, key_len) == 0; i++) {
+        int64_t ts = g->idx[i].ts;
+        if (ts >= from && ts <= to) result_add(q, &g->recs[g->idx[i].rec]);
+    }
+}
+
+static int cmp_rec_desc(const void* a, const void* b) {
+    int64_t x = ((const PlateRecord*)a)->wall_time_us;
+    int64_t y = ((const PlateRecord*)b)->wall_time_us;
+    return (x < y) - (x > y);
+}
+
+int plate_store_query(PlateStore* s, const char* prefix, int64_t from, int64_t to,
+                      PlateRecord* out, int max_out) {
+    if (max_out <= 0) return 0;
+    char key[KEY_SIZE] = {0};
+    if (prefix) plate_store_normalize(prefix, key, KEY_SIZE);
+    int key_len = strlen(key);
+    QueryResult q = { out, max_out, 0 };
+
+    pthread_rwlock_rdlock(&s->lock);
+
+    // 活动段 (最新)
+    if (s->active_count > 0 && s->active_max_ts >= from && s->active_min_ts <= to) {
+        for (int i = s->active_count - 1; i >= 0; i--) {
+            const PlateRecord* r = &s->active_recs[i];
+            if (r->wall_time_us < from || r->wall_time_us > to) continue;
+            if (key_len && memcmp(s->active_keys[i], key, key_len) != 0) continue;
+            result_add(&q, r);
+        }
+    }
+
+    // 已封存段: 从新到旧, 段内全部早于当前结果集时提前结束
+    for (int i = s->nsegs - 1; i >= 0; i--) {
+        const Segment* g = &s->segs[i];
+        if (g->max_ts < from || g->min_ts > to) continue;
+        if (q.n >= q.max_out && g->max_ts <= result_oldest(&q)) continue;
+        query_segment(g, key, key_len, from, to, &q);
+    }
+
+    pthread_rwlock_unlock(&s->lock);
+
+    qsort(out, q.n, sizeof(PlateRecord), cmp_rec_desc);
+    return q.n;
+}
+
+// --- 维护: 保留期 + 合并 ---
+
+static void remove_segment_files(PlateStore* s, uint32_t id) {
+    char path[300];
+    seg_path(s, id, "dat", path, sizeof(path));
+    unlink(path);
+    seg_path(s, id, "idx", path, sizeof(path));
+    unlink(path);
+}
+
+// 合并 segs[a..b] (时间相邻且有序) 为一个段, 沿用 segs[a] 的段号
+static int merge_segments(PlateStore* s, int a, int b) {
+    uint64_t total = 0;
+    for (int i = a; i <= b; i++) total += s->segs[i].count;
+    uint32_t id = s->segs[a].id;
+    uint32_t last_id = s->segs[b].last_id;
+
+    char dat[300], idx[300], tmp[320];
+    seg_path(s, id, "dat", dat, sizeof(dat));
+    seg_path(s, id, "idx", idx, sizeof(idx));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", dat);
+
+    // 已封存段只读, 合并过程中无需加锁, 查询照常进行
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    int ok = 1;
+    for (int i = a; i <= b && ok; i++)
+        ok = write_all(fd, s->segs[i].recs, (size_t)s->segs[i].count * sizeof(PlateRecord)) == 0;
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+    if (!ok) { unlink(tmp); return -1; }
+
+    size_t len = 0;
+    PlateRecord* merged = map_file(tmp, &len);
+    if (!merged) { unlink(tmp); return -1; }
+    // 先替换索引再替换数据: 两步之间崩溃时索引与旧数据条数不符, 启动时按旧数据重建,
+    // 旧段仍然完整, 不会出现重复记录; 两步都完成后启动扫描按覆盖范围清理旧段
+    char idx_tmp[320];
+    snprintf(idx_tmp, sizeof(idx_tmp), "%s.merge", idx);
+    int r = write_index(idx_tmp, merged, (uint32_t)total, id, last_id);
+    munmap(merged, len);
+    if (r != 0) { unlink(tmp); return -1; }
+    if (rename(idx_tmp, idx) != 0 || rename(tmp, dat) != 0) {
+        unlink(tmp);
+        unlink(idx_tmp);
+        return -1;
+    }
+
+    Segment g;
+    if (seg_load(s, id, &g) != 0) return -1;
+
+    pthread_rwlock_wrlock(&s->lock);
+    for (int i = a; i <= b; i++) seg_unmap(&s->segs[i]);
+    s->segs[a] = g;
+    memmove(&s->segs[a + 1], &s->segs[b + 1], (s->nsegs - b - 1) * sizeof(Segment));
+    int removed = b - a;
+    s->nsegs -= removed;
+    pthread_rwlock_unlock(&s->lock);
+
+    for (uint32_t old = id + 1; old <= last_id; old++) remove_segment_files(s, old);
+    printf("[Store] 合并 %d 段 -> seg_%08u (%llu 条)\n", removed + 1, id, (unsigned long long)total);
+    return 0;
+}
+
+void plate_store_maintain(PlateStore* s, int64_t now_us) {
+    if (s->cfg.read_only) return;
+    // 1. 保留期: 整段删除
+    if (s->cfg.retention_days > 0) {
+        int64_t cutoff = now_us - (int64_t)s->cfg.retention_days * 86400LL * 1000000LL;
+        while (s->nsegs > 0 && s->segs[0].max_ts < cutoff) {
+            pthread_rwlock_wrlock(&s->lock);
+            Segment g = s->segs[0];
+            memmove(&s->segs[0], &s->segs[1], (s->nsegs - 1) * sizeof(Segment));
+            s->nsegs--;
+            pthread_rwlock_unlock(&s->lock);
+
+            seg_unmap(&g);
+            for (uint32_t id = g.id; id <= g.last_id; id++) remove_segment_files(s, id);
+            printf("[Store] 删除过期段 seg_%08u (%u 条)\n", g.id, g.count);
+        }
+    }
+
+    // 2. 合并: 把相邻的小段合并到 merge_records 左右, 减少查询时的段数
+    for (int a = 0; a < s->nsegs; a++) {
+        if (s->segs[a].count >= (uint32_t)s->cfg.merge_records) continue;
+        uint64_t total = s->segs[a].count;
+        int b = a;
+        while (b + 1 < s->nsegs &&
+               total + s->segs[b + 1].count <= (uint64_t)s->cfg.merge_records &&
+               s->segs[b + 1].min_ts >= s->segs[b].max_ts) {
+            b++;
+            total += s->segs[b].count;
+        }
+        if (b > a) {
+            merge_segments(s, a, b);
+            return; // 每次只合并一组, 避免长时间占用写线程
+        }
+    }
+}
@@ -0,0 +1,87 @@
+// 空闲省电: 长时间无车时降低采集分辨率与帧率, 只做亮度网格占用检查, 画面变化后恢复全速
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "include/power_save.h"
+#include "include/image_utils.h"
+
+#define WARMUP_FRAMES 3          // 切换分辨率后自动曝光需要几帧稳定
+#define BACKGROUND_ALPHA 0.05f   // 背景缓慢跟随光照变化
+
+void power_save_init(PowerSave* ps, const PowerSaveConfig* cfg) {
+    memset(ps, 0, sizeof(*ps));
+    ps->cfg = *cfg;
+}
+
+int power_save_complete(PowerSave* ps, uint64_t now, int vehicles) {
+    if (vehicles > 0 || ps->last_activity == 0) ps->last_activity = now;
+    return ps->cfg.enable && ps->cfg.idle_after_s > 0 &&
+           now - ps->last_activity >= (uint64_t)ps->cfg.idle_after_s * 1000000ULL;
+}
+
+void power_save_enter(PowerSave* ps, uint64_t now, const RoiPolygon* roi, int full_w, int full_h) {
+    ps->idle = 1;
+    ps->idle_since = now;
+    ps->warmup = WARMUP_FRAMES;
+    ps->entries++;
+    for (int gy = 0; gy < MOTION_GRID_H; gy++) {
+        for (int gx = 0; gx < MOTION_GRID_W; gx++) {
+            float x = (gx + 0.5f) * full_w / MOTION_GRID_W;
+            float y = (gy + 0.5f) * full_h / MOTION_GRID_H;
+            ps->mask[gy][gx] = (unsigned char)roi_contains(roi, x, y);
+        }
+    }
+}
+
+void power_save_leave(PowerSave* ps, uint64_t now) {
+    ps->idle = 0;
+    ps->last_activity = now;
+    if (now > ps->idle_since) ps->idle_seconds += (now - ps->idle_since) / 1e6;
+}
+
+int power_save_motion(PowerSave* ps, const unsigned char* yuyv, int w, int h) {
+    // 网格平均亮度: YUYV 中偶数字节为 Y, 隔行隔点采样
+    float cur[MOTION_GRID_H][MOTION_GRID_W];
+    for (int gy = 0; gy < MOTION_GRID_H; gy++) {
+        int y0 = gy * h / MOTION_GRID_H, y1 = (gy + 1) * h / MOTION_GRID_H;
+        for (int gx = 0; gx < MOTION_GRID_W; gx++) {
+            int x0 = gx * w / MOTION_GRID_W, x1 = (gx + 1) * w / MOTION_GRID_W;
+            unsigned sum = 0, cnt = 0;
+            for (int y = y0; y < y1; y += 2) {
+                const unsigned char* row = yuyv + (size_t)y * w * 2;
+                for (int x = x0; x < x1; x += 2) { sum += row[x * 2]; cnt++; }
+            }
+            cur[gy][gx] = cnt ? (float)sum / cnt : 0.0f;
+        }
+    }
+
+    if (ps->warmup > 0) {
+        ps->warmup--;
+        memcpy(ps->background, cur, sizeof(cur));
+        return 0;
+    }
+
+    // 整体亮度变化 (云层、路灯、自动曝光) 不算运动: 先扣除检测区域内网格的平均变化
+    float mean = 0.0f;
+    int cells = 0;
+    for (int gy = 0; gy < MOTION_GRID_H; gy++) {
+        for (int gx = 0; gx < MOTION_GRID_W; gx++) {
+            if (!ps->mask[gy][gx]) continue;
+            mean += cur[gy][gx] - ps->background[gy][gx];
+            cells++;
+        }
+    }
+    if (cells > 0) mean /= cells;
+
+    int changed = 0;
+    for (int gy = 0; gy < MOTION_GRID_H; gy++) {
+        for (int gx = 0; gx < MOTION_GRID_W; gx++) {
+            float d = cur[gy][gx] - ps->background[gy][gx];
+            if (ps->mask[gy][gx] && fabsf(d - mean) > ps->cfg.cell_delta) changed++;
+            ps->background[gy][gx] += BACKGROUND_ALPHA * d;
+        }
+    }
+    ps->changed = changed;
+    ps->cells = cells;
+    return cells > 0 && changed > 0 && changed >= ps->cfg.motion_cells * cells;
+}
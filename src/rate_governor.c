@@ -0,0 +1,97 @@
+// 自适应处理速率调度 (替代固定的隔 N 帧处理)
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "include/rate_governor.h"
+
+#define EWMA_ALPHA 0.2f
+
+uint64_t governor_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void governor_init(RateGovernor* g, const GovernorConfig* cfg) {
+    memset(g, 0, sizeof(*g));
+    g->cfg = *cfg;
+    if (g->cfg.idle_interval_ms < 0) g->cfg.idle_interval_ms = 0;
+    if (g->cfg.latency_budget_ms <= 0) g->cfg.latency_budget_ms = 300;
+    if (g->cfg.activity_hold_ms < 0) g->cfg.activity_hold_ms = 0;
+
+    g->interval_ms = (float)g->cfg.idle_interval_ms;
+    // 初始估计: 预算的一半, 第一帧完成后即被真实值取代
+    g->proc_ewma_ms = g->cfg.latency_budget_ms * 0.5f;
+}
+
+int governor_admit(RateGovernor* g, uint64_t ts, uint64_t now) {
+    float budget = (float)g->cfg.latency_budget_ms;
+    float age_ms = now > ts ? (now - ts) / 1000.0f : 0.0f;
+
+    // 1. 截止时间检查: 排队时间 + 预计处理时间超出预算, 不如等下一帧
+    //    机器本身处理不过来时 (proc >= budget) 至少保留 1/4 预算的余量, 避免全部丢弃
+    float slack = budget - g->proc_ewma_ms;
+    if (slack < budget * 0.25f) slack = budget * 0.25f;
+    if (age_ms > slack) {
+        g->dropped++;
+        return GOV_DROP;
+    }
+
+    // 2. 速率控制: 距上次放行的帧不足当前间隔则跳过
+    if (g->last_admit_ts != 0 && ts > g->last_admit_ts &&
+        (ts - g->last_admit_ts) / 1000.0f < g->interval_ms) {
+        g->skipped++;
+        return GOV_SKIP;
+    }
+
+    g->last_admit_ts = ts;
+    return GOV_PROCESS;
+}
+
+void governor_complete(RateGovernor* g, uint64_t ts, uint64_t start, uint64_t done, int vehicles) {
+    float budget = (float)g->cfg.latency_budget_ms;
+    float proc_ms = done > start ? (done - start) / 1000.0f : 0.0f;
+    float lat_ms  = done > ts ? (done - ts) / 1000.0f : proc_ms;
+
+    g->processed++;
+    g->latency_sum_ms += lat_ms;
+    if (lat_ms > g->latency_max_ms) g->latency_max_ms = lat_ms;
+    if (lat_ms > budget) g->over_budget++;
+
+    g->proc_ewma_ms    += EWMA_ALPHA * (proc_ms - g->proc_ewma_ms);
+    g->latency_ewma_ms += EWMA_ALPHA * (lat_ms - g->latency_ewma_ms);
+
+    // 车道活跃: 有车则延长全速窗口
+    if (vehicles > 0) g->active_until = done + (uint64_t)g->cfg.activity_hold_ms * 1000ULL;
+    int active = done < g->active_until;
+
+    // 目标间隔: 有车全速 (0), 空闲按 processing_interval
+    float target = active ? 0.0f : (float)g->cfg.idle_interval_ms;
+
+    if (g->latency_ewma_ms > budget) {
+        // 超预算: 乘性退避, 但间隔不超过一次处理耗时 (再长只会增加决策时间)
+        float backoff = g->interval_ms * 1.5f;
+        if (backoff < 1.0f) backoff = 1.0f;
+        if (backoff > g->proc_ewma_ms) backoff = g->proc_ewma_ms;
+        g->interval_ms = backoff > target ? backoff : target;
+    } else if (active) {
+        // 车辆到达: 立即提速
+        g->interval_ms = target;
+    } else {
+        // 空闲: 平滑回到空闲间隔
+        g->interval_ms = target + (g->interval_ms - target) * 0.7f;
+    }
+}
+
+void governor_report(RateGovernor* g, uint64_t now, int interval_s) {
+    if (g->last_report == 0) { g->last_report = now; return; }
+    if (now - g->last_report < (uint64_t)interval_s * 1000000ULL) return;
+    g->last_report = now;
+
+    float avg = g->processed ? (float)(g->latency_sum_ms / g->processed) : 0.0f;
+    printf("\n[Governor] 处理 %lu | 跳过 %lu | 超时丢弃 %lu | 超预算 %lu | 延迟 平均 %.1fms 最大 %.1fms | 间隔 %.0fms%s\n",
+           g->processed, g->skipped, g->dropped, g->over_budget,
+           avg, g->latency_max_ms, g->interval_ms,
+           now < g->active_until ? " (车道活跃)" : "");
+    g->latency_max_ms = 0.0f;
+}
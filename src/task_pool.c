@@ -0,0 +1,192 @@
+// 工作窃取任务池
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "include/task_pool.h"
+
+#define TASK_QUEUE_CAP 64
+
+typedef struct {
+    pthread_mutex_t lock;
+    int items[TASK_QUEUE_CAP];
+    int head, tail;          // [head, tail): 所有者从 tail 取 (后进先出), 窃取者从 head 取
+} TaskQueue;
+
+struct TaskPool {
+    int nqueues;             // 后台线程数 + 1, 0 号队列属于调用 task_pool_run 的线程
+    TaskQueue* queues;
+    pthread_t* threads;
+    int nthreads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;  // 新批次到达
+    pthread_cond_t done_cv;  // 批次全部完成
+    task_fn fn;
+    void* arg;
+    int pending;             // 本批次未完成的任务数
+    unsigned batch;          // 批次号, 后台线程据此判断是否有新任务
+    int stop;
+};
+
+typedef struct {
+    TaskPool* pool;
+    int self;
+} WorkerArg;
+
+static int queue_pop(TaskQueue* q) {
+    int idx = -1;
+    pthread_mutex_lock(&q->lock);
+    if (q->tail > q->head) idx = q->items[--q->tail];
+    pthread_mutex_unlock(&q->lock);
+    return idx;
+}
+
+static int queue_steal(TaskQueue* q) {
+    int idx = -1;
+    pthread_mutex_lock(&q->lock);
+    if (q->tail > q->head) idx = q->items[q->head++];
+    pthread_mutex_unlock(&q->lock);
+    return idx;
+}
+
+// 先取自己队列的任务, 取完后依次从其他队列窃取, 全部为空时返回
+static void run_tasks(TaskPool* pool, int self) {
+    for (;;) {
+        int idx = queue_pop(&pool->queues[self]);
+        for (int k = 1; idx < 0 && k < pool->nqueues; k++) {
+            idx = queue_steal(&pool->queues[(self + k) % pool->nqueues]);
+        }
+        if (idx < 0) return;
+
+        // fn/arg 在任务入队前写好, 队列锁保证这里读到的是本批次的值
+        pool->fn(pool->arg, idx);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) pthread_cond_signal(&pool->done_cv);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void* worker_main(void* p) {
+    WorkerArg* wa = (WorkerArg*)p;
+    TaskPool* pool = wa->pool;
+    int self = wa->self;
+    free(wa);
+
+    char name[16];
+    snprintf(name, sizeof(name), "vehicle-%d", self);
+    pthread_setname_np(pthread_self(), name);
+
+    unsigned seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stop && pool->batch == seen) pthread_cond_wait(&pool->work_cv, &pool->lock);
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->batch;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_tasks(pool, self);
+    }
+}
+
+TaskPool* task_pool_create(int workers, const cpu_set_t* cpus) {
+    if (workers <= 0) return NULL;
+    TaskPool* pool = calloc(1, sizeof(TaskPool));
+    if (!pool) return NULL;
+    pool->nqueues = workers + 1;
+    pool->queues = calloc(pool->nqueues, sizeof(TaskQueue));
+    pool->threads = calloc(workers, sizeof(pthread_t));
+    if (!pool->queues || !pool->threads) {
+        free(pool->queues);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    for (int i = 0; i < pool->nqueues; i++) pthread_mutex_init(&pool->queues[i].lock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cv, NULL);
+    pthread_cond_init(&pool->done_cv, NULL);
+
+    // 在线程属性中设置亲和性, 线程从第一条指令起就在指定 CPU 上
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (cpus && CPU_COUNT(cpus) > 0) {
+        int err = pthread_attr_setaffinity_np(&attr, sizeof(*cpus), cpus);
+        if (err != 0) printf("[TaskPool] 工作线程绑核失败: %s\n", strerror(err));
+    }
+    for (int i = 0; i < workers; i++) {
+        WorkerArg* wa = malloc(sizeof(WorkerArg));
+        wa->pool = pool;
+        wa->self = i + 1;
+        if (pthread_create(&pool->threads[i], &attr, worker_main, wa) != 0) {
+            printf("[TaskPool] 创建工作线程失败, 实际 %d 个\n", i);
+            free(wa);
+            break;
+        }
+        pool->nthreads++;
+    }
+    pthread_attr_destroy(&attr);
+    // 没有线程的队列不会被所有者取, 但仍会被窃取, 不影响正确性
+    return pool;
+}
+
+void task_pool_run(TaskPool* pool, task_fn fn, void* arg, int count) {
+    if (count <= 0) return;
+    if (!pool || pool->nthreads == 0 || count == 1) {
+        for (int i = 0; i < count; i++) fn(arg, i);
+        return;
+    }
+
+    // 队列容量有限, 超出部分分批执行
+    int per_batch = TASK_QUEUE_CAP * pool->nqueues;
+    for (int base = 0; base < count; base += per_batch) {
+        int n = count - base < per_batch ? count - base : per_batch;
+
+        pthread_mutex_lock(&pool->lock);
+        pool->fn = fn;
+        pool->arg = arg;
+        pool->pending = n;
+        pthread_mutex_unlock(&pool->lock);
+
+        // 轮流分配到各队列; 所有者后进先出, 所以倒序入队, 让序号小的任务先开始
+        for (int i = n - 1; i >= 0; i--) {
+            TaskQueue* q = &pool->queues[i % pool->nqueues];
+            pthread_mutex_lock(&q->lock);
+            if (q->head == q->tail) q->head = q->tail = 0;
+            q->items[q->tail++] = base + i;
+            pthread_mutex_unlock(&q->lock);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        pool->batch++;
+        pthread_cond_broadcast(&pool->work_cv);
+        pthread_mutex_unlock(&pool->lock);
+
+        run_tasks(pool, 0);
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending > 0) pthread_cond_wait(&pool->done_cv, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+void task_pool_destroy(TaskPool* pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work_cv);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->nthreads; i++) pthread_join(pool->threads[i], NULL);
+
+    for (int i = 0; i < pool->nqueues; i++) pthread_mutex_destroy(&pool->queues[i].lock);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cv);
+    pthread_cond_destroy(&pool->done_cv);
+    free(pool->queues);
+    free(pool->threads);
+    free(pool);
+}
@@ -0,0 +1,226 @@
+// 帧级追踪: 每线程缓冲区 + Chrome trace JSON 导出
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "include/trace.h"
+
+#define TRACE_BUFFER_EVENTS 8192
+
+typedef struct {
+    const char* name;
+    uint64_t ts_us;
+    uint64_t dur_us;
+    uint64_t frame;
+    int vehicle;
+} TraceEvent;
+
+// 只由所属线程写入; count 以 release 发布, 导出时 acquire 读取
+typedef struct TraceBuffer {
+    int tid;
+    char thread_name[16];
+    unsigned epoch;          // 所属记录轮次, 与当前轮次不同时先清空
+    int count;
+    int dropped;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+    struct TraceBuffer* next;
+} TraceBuffer;
+
+static TraceBuffer* g_buffers = NULL;      // 所有线程的缓冲区 (只增不减)
+static __thread TraceBuffer* t_buffer = NULL;
+
+static int g_requested = 0;   // 待开始记录的帧数
+static int g_active = 0;      // 1: 正在记录
+static unsigned g_epoch = 0;
+static uint64_t g_frame_id = 0;
+static int g_remaining = 0;   // 本轮剩余帧数 (只由主循环访问)
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static TraceBuffer* thread_buffer(void) {
+    if (t_buffer) return t_buffer;
+    TraceBuffer* b = calloc(1, sizeof(TraceBuffer));
+    if (!b) return NULL;
+    b->tid = (int)syscall(SYS_gettid);
+    if (pthread_getname_np(pthread_self(), b->thread_name, sizeof(b->thread_name)) != 0) {
+        snprintf(b->thread_name, sizeof(b->thread_name), "%d", b->tid);
+    }
+    // 无锁入链表
+    TraceBuffer* head = __atomic_load_n(&g_buffers, __ATOMIC_RELAXED);
+    do {
+        b->next = head;
+    } while (!__atomic_compare_exchange_n(&g_buffers, &head, b, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    t_buffer = b;
+    return b;
+}
+
+void trace_request(int frames) {
+    __atomic_store_n(&g_requested, frames > 0 ? frames : 1, __ATOMIC_RELAXED);
+}
+
+int trace_frame_begin(uint64_t frame_id) {
+    int started = 0;
+    if (g_remaining == 0) {
+        int frames = __atomic_exchange_n(&g_requested, 0, __ATOMIC_RELAXED);
+        if (frames <= 0) return 0;
+        g_remaining = frames;
+        __atomic_add_fetch(&g_epoch, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&g_active, 1, __ATOMIC_RELEASE);
+        printf("[Trace] 开始记录 %d 帧\n", frames);
+        started = 1;
+    }
+    __atomic_store_n(&g_frame_id, frame_id, __ATOMIC_RELAXED);
+    return started;
+}
+
+int trace_frame_end(void) {
+    if (g_remaining == 0 || --g_remaining > 0) return 0;
+    __atomic_store_n(&g_active, 0, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int trace_stop(void) {
+    if (g_remaining == 0) return 0;
+    g_remaining = 0;
+    __atomic_store_n(&g_active, 0, __ATOMIC_RELEASE);
+    return 1;
+}
+
+uint64_t trace_begin(void) {
+    return __atomic_load_n(&g_active, __ATOMIC_RELAXED) ? now_us() : 0;
+}
+
+void trace_end(uint64_t start, const char* name, int vehicle) {
+    if (!start) return;
+    TraceBuffer* b = thread_buffer();
+    if (!b) return;
+
+    unsigned epoch = __atomic_load_n(&g_epoch, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&b->epoch, __ATOMIC_RELAXED) != epoch) {
+        __atomic_store_n(&b->count, 0, __ATOMIC_RELAXED);
+        b->dropped = 0;
+        __atomic_store_n(&b->epoch, epoch, __ATOMIC_RELEASE);
+    }
+    int n = b->count;
+    if (n >= TRACE_BUFFER_EVENTS) {
+        b->dropped++;
+        return;
+    }
+    TraceEvent* e = &b->events[n];
+    e->name = name;
+    e->ts_us = start;
+    e->dur_us = now_us() - start;
+    e->frame = __atomic_load_n(&g_frame_id, __ATOMIC_RELAXED);
+    e->vehicle = vehicle;
+    __atomic_store_n(&b->count, n + 1, __ATOMIC_RELEASE);
+}
+
+// 把 "key" 后的数值替换为 value, 结果写入 out; 没有该键时原样复制
+static void replace_number(const char* line, const char* key, long long value, char* out, size_t size) {
+    const char* p = strstr(line, key);
+    if (!p) {
+        snprintf(out, size, "%s", line);
+        return;
+    }
+    p += strlen(key);
+    while (*p == ' ' || *p == ':') p++;
+    const char* end = p;
+    while (*end == '-' || (*end >= '0' && *end <= '9')) end++;
+    snprintf(out, size, "%.*s%lld%s", (int)(p - line), line, value, end);
+}
+
+// ORT profiling 文件每行一个事件; ts 相对 profiling 起始时间 (us), 换算到本进程的 CLOCK_MONOTONIC
+static int merge_ort(FILE* out, const TraceOrtProfile* prof, int pid, int64_t realtime_minus_mono_us) {
+    FILE* f = fopen(prof->file, "r");
+    if (!f) {
+        printf("[Trace] 无法读取 ORT profiling 文件 %s\n", prof->file);
+        return 0;
+    }
+    fprintf(out, ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"ORT %s\"}}", pid, prof->model);
+
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    int merged = 0;
+    while ((len = getline(&line, &cap, f)) > 0) {
+        char* s = line;
+        while (*s == ' ' || *s == '[' || *s == ',') s++;
+        if (*s != '{') continue;
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == ',' || line[len - 1] == ']')) line[--len] = '\0';
+
+        const char* ts_key = strstr(s, "\"ts\"");
+        if (!ts_key) continue;
+        long long ts = strtoll(ts_key + 4 + strspn(ts_key + 4, " :"), NULL, 10);
+        long long mono = (long long)(prof->start_ns / 1000) + ts - realtime_minus_mono_us;
+
+        size_t size = strlen(s) + 64;
+        char* a = malloc(size);
+        char* b = malloc(size);
+        if (a && b) {
+            replace_number(s, "\"ts\"", mono, a, size);
+            replace_number(a, "\"pid\"", pid, b, size);
+            fprintf(out, ",\n%s", b);
+            merged++;
+        }
+        free(a);
+        free(b);
+    }
+    free(line);
+    fclose(f);
+    remove(prof->file);
+    return merged;
+}
+
+int trace_dump(const char* path, const TraceOrtProfile* ort, int ort_count) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        printf("[Trace] 无法写入 %s\n", path);
+        return -1;
+    }
+    int pid = (int)getpid();
+    unsigned epoch = __atomic_load_n(&g_epoch, __ATOMIC_RELAXED);
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"plate_recognition\"}}", pid);
+
+    int events = 0, dropped = 0;
+    for (TraceBuffer* b = __atomic_load_n(&g_buffers, __ATOMIC_ACQUIRE); b; b = b->next) {
+        if (__atomic_load_n(&b->epoch, __ATOMIC_ACQUIRE) != epoch) continue;
+        int n = __atomic_load_n(&b->count, __ATOMIC_ACQUIRE);
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                pid, b->tid, b->thread_name);
+        for (int i = 0; i < n; i++) {
+            const TraceEvent* e = &b->events[i];
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%llu,\"dur\":%llu,"
+                       "\"args\":{\"frame\":%llu",
+                    e->name, pid, b->tid, (unsigned long long)e->ts_us, (unsigned long long)e->dur_us,
+                    (unsigned long long)e->frame);
+            if (e->vehicle >= 0) fprintf(f, ",\"vehicle\":%d", e->vehicle);
+            fprintf(f, "}}");
+        }
+        events += n;
+        dropped += b->dropped;
+    }
+
+    // ORT 以 high_resolution_clock (libstdc++ 中即 CLOCK_REALTIME) 记录起始时间
+    struct timespec rt, mt;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    clock_gettime(CLOCK_MONOTONIC, &mt);
+    int64_t offset = ((int64_t)rt.tv_sec - mt.tv_sec) * 1000000LL + (rt.tv_nsec - mt.tv_nsec) / 1000;
+    int ort_events = 0;
+    for (int i = 0; i < ort_count; i++) ort_events += merge_ort(f, &ort[i], pid + 1 + i, offset);
+
+    fprintf(f, "\n]}\n");
+    int err = ferror(f);
+    fclose(f);
+    printf("[Trace] 已导出 %s: %d 个区间%s, ORT 事件 %d 个\n", path, events,
+           dropped ? " (缓冲区满, 部分丢弃)" : "", ort_events);
+    return err ? -1 : 0;
+}
@@ -1,8 +1,555 @@
 #include "include/utils.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+// ---------------------------------------------------------------
+// INI 解析
+// ---------------------------------------------------------------
+
+enum { CFG_STR, CFG_INT, CFG_FLOAT, CFG_BOOL, CFG_POLY, CFG_CHOICE };
+
+typedef struct {
+    const char* section;
+    const char* key;
+    int type;
+    size_t offset;
+    size_t size;      // 字符串缓冲区 / 多边形大小
+    float min, max;   // 数值范围
+    int live;         // 1: 可热加载, 0: 需重启
+    const char* choices; // CFG_CHOICE 的可选值, 以空格分隔
+} ConfigKey;
+
+#define STR_KEY(sec, k, field, live) \
+    { sec, k, CFG_STR, offsetof(AppConfig, field), sizeof(((AppConfig*)0)->field), 0, 0, live, NULL }
+#define NUM_KEY(sec, k, type, field, lo, hi, live) \
+    { sec, k, type, offsetof(AppConfig, field), 0, lo, hi, live, NULL }
+#define POLY_KEY(sec, k, field, live) \
+    { sec, k, CFG_POLY, offsetof(AppConfig, field), sizeof(RoiPolygon), 0, 0, live, NULL }
+#define CHOICE_KEY(sec, k, field, choices, live) \
+    { sec, k, CFG_CHOICE, offsetof(AppConfig, field), sizeof(((AppConfig*)0)->field), 0, 0, live, choices }
+
+static const ConfigKey g_keys_table[] = {
+    STR_KEY("Camera", "device", device, 0),
+    NUM_KEY("Camera", "width",  CFG_INT, width,  160, 7680, 0),
+    NUM_KEY("Camera", "height", CFG_INT, height, 120, 4320, 0),
+    NUM_KEY("Camera", "fps",    CFG_INT, fps,    1, 120, 0),
+    NUM_KEY("Camera", "buffers", CFG_INT, buffers, 2, 32, 0),
+    NUM_KEY("Camera", "dmabuf",  CFG_BOOL, dmabuf, 0, 1, 0),
+    POLY_KEY("Camera", "roi", roi, 1),
+
+    STR_KEY("Models", "vehicle_model", vehicle_model, 0),
+    STR_KEY("Models", "plate_detector_model", plate_model, 0),
+    STR_KEY("Models", "ocr_model", ocr_model, 0),
+    STR_KEY("Models", "ocr_keys", ocr_keys, 0),
+    STR_KEY("Models", "ocr_fast_model", ocr_fast_model, 0),
+    STR_KEY("Models", "ocr_fast_keys", ocr_fast_keys, 0),
+
+    STR_KEY("Providers", "vehicle", vehicle_providers, 0),
+    STR_KEY("Providers", "plate", plate_providers, 0),
+    STR_KEY("Providers", "ocr", ocr_providers, 0),
+    STR_KEY("Providers", "xnnpack_options", xnnpack_options, 0),
+    STR_KEY("Providers", "dnnl_options", dnnl_options, 0),
+    STR_KEY("Providers", "openvino_options", openvino_options, 0),
+
+    NUM_KEY("Thresholds", "vehicle", CFG_FLOAT, threshold,       0.01f, 1.0f, 1),
+    NUM_KEY("Thresholds", "plate",   CFG_FLOAT, plate_threshold, 0.01f, 1.0f, 1),
+    NUM_KEY("Thresholds", "ocr",     CFG_FLOAT, ocr_threshold,   0.0f,  1.0f, 1),
+    NUM_KEY("Thresholds", "nms",     CFG_FLOAT, nms_threshold,   0.01f, 1.0f, 1),
+
+    NUM_KEY("System", "processing_interval",     CFG_INT,  processing_interval, 0, 10000, 1),
+    NUM_KEY("System", "latency_budget_ms",       CFG_INT,  latency_budget_ms,   10, 10000, 1),
+    NUM_KEY("System", "activity_hold_ms",        CFG_INT,  activity_hold_ms,    0, 600000, 1),
+    NUM_KEY("System", "max_detection_per_frame", CFG_INT,  max_detection_per_frame, 1, 64, 1),
+    NUM_KEY("System", "enable_anti_fraud",       CFG_BOOL, enable_anti_fraud, 0, 1, 1),
+
+    NUM_KEY("Performance", "intra_op_threads", CFG_INT, intra_op_threads, 0, 64, 0),
+    NUM_KEY("Performance", "inter_op_threads", CFG_INT, inter_op_threads, 0, 64, 0),
+    NUM_KEY("Performance", "allow_spinning",     CFG_BOOL, allow_spinning, 0, 1, 0),
+    NUM_KEY("Performance", "graph_optimization", CFG_INT,  graph_optimization, 0, 3, 0),
+    NUM_KEY("Performance", "parallel_execution", CFG_BOOL, parallel_execution, 0, 1, 0),
+    NUM_KEY("Performance", "vehicle_workers",    CFG_INT,  vehicle_workers, 0, 16, 0),
+    NUM_KEY("Performance", "yolo_input_size",  CFG_INT, yolo_input_size, 128, 1920, 1),
+    NUM_KEY("Performance", "yolo_input_height", CFG_INT, yolo_input_height, 0, 1920, 1),
+    NUM_KEY("Performance", "det_size",         CFG_INT, det_size,        128, 1920, 1),
+    NUM_KEY("Performance", "ocr_input_width",  CFG_INT, ocr_input_width, 48, 1280, 1),
+
+    NUM_KEY("Quality", "min_score",      CFG_FLOAT, quality_min_score, 0, 1, 1),
+    NUM_KEY("Quality", "improve_margin", CFG_FLOAT, quality_improve_margin, 0, 1, 1),
+
+    STR_KEY("Lists", "file", list_file, 0),
+    NUM_KEY("Lists", "max_edits", CFG_INT, list_max_edits, 0, 3, 1),
+    NUM_KEY("Lists", "allow_max_edits", CFG_INT, list_allow_max_edits, 0, 3, 1),
+
+    STR_KEY("Events", "dir", event_dir, 0),
+    NUM_KEY("Events", "queue_size",        CFG_INT,  event_queue_size, 16, 65536, 0),
+    NUM_KEY("Events", "crop_drop_percent", CFG_INT,  event_crop_drop_percent, 1, 100, 0),
+    NUM_KEY("Events", "jpeg_quality",      CFG_INT,  event_jpeg_quality, 1, 100, 0),
+    NUM_KEY("Events", "save_crops",        CFG_BOOL, event_save_crops, 0, 1, 0),
+    NUM_KEY("Events", "jsonl",             CFG_BOOL, event_jsonl, 0, 1, 0),
+    NUM_KEY("Events", "binary",            CFG_BOOL, event_binary, 0, 1, 0),
+
+    NUM_KEY("Store", "enable",          CFG_BOOL, store_enable, 0, 1, 0),
+    STR_KEY("Store", "dir", store_dir, 0),
+    NUM_KEY("Store", "segment_records", CFG_INT,  store_segment_records, 1024, 16777216, 0),
+    NUM_KEY("Store", "merge_records",   CFG_INT,  store_merge_records, 1024, 268435456, 0),
+    NUM_KEY("Store", "retention_days",  CFG_INT,  store_retention_days, 0, 36500, 0),
+
+    NUM_KEY("Affinity", "enable", CFG_BOOL, affinity_enable, 0, 1, 0),
+    STR_KEY("Affinity", "capture_cpus", capture_cpus, 0),
+    STR_KEY("Affinity", "io_cpus", io_cpus, 0),
+    STR_KEY("Affinity", "ort_cpus", ort_cpus, 0),
+    NUM_KEY("Affinity", "capture_fifo",     CFG_BOOL, capture_fifo, 0, 1, 0),
+    NUM_KEY("Affinity", "capture_priority", CFG_INT,  capture_priority, 1, 99, 0),
+
+    STR_KEY("Trace", "dir", trace_dir, 1),
+    NUM_KEY("Trace", "frames",      CFG_INT,  trace_frames, 1, 1000, 1),
+    NUM_KEY("Trace", "ort_profile", CFG_BOOL, trace_ort_profile, 0, 1, 1),
+
+    NUM_KEY("Cascade", "enable",     CFG_BOOL,  cascade_enable, 0, 1, 1),
+    NUM_KEY("Cascade", "fast_width", CFG_INT,   cascade_fast_width, 48, 1280, 1),
+    NUM_KEY("Cascade", "accept",     CFG_FLOAT, cascade_accept, 0.0f, 1.0f, 1),
+    STR_KEY("Cascade", "recrop", cascade_recrop, 1),
+
+    CHOICE_KEY("Pipeline", "mode", pipeline_mode, "cascade frame plate_only", 1),
+    NUM_KEY("Pipeline", "frame_det_size", CFG_INT, frame_det_size, 320, 2560, 1),
+
+    NUM_KEY("PowerSave", "enable",       CFG_BOOL,  powersave_enable, 0, 1, 1),
+    NUM_KEY("PowerSave", "idle_after_s", CFG_INT,   powersave_idle_s, 10, 86400, 1),
+    NUM_KEY("PowerSave", "width",        CFG_INT,   powersave_width, 160, 7680, 1),
+    NUM_KEY("PowerSave", "height",       CFG_INT,   powersave_height, 120, 4320, 1),
+    NUM_KEY("PowerSave", "fps",          CFG_INT,   powersave_fps, 1, 120, 1),
+    NUM_KEY("PowerSave", "cell_delta",   CFG_INT,   powersave_cell_delta, 1, 255, 1),
+    NUM_KEY("PowerSave", "motion_cells", CFG_FLOAT, powersave_motion_cells, 0.0f, 1.0f, 1),
+
+    STR_KEY("Service", "socket", service_socket, 0),
+    NUM_KEY("Service", "slots",         CFG_INT, service_slots, 1, 8, 0),
+    NUM_KEY("Service", "max_batch",     CFG_INT, service_max_batch, 1, 32, 0),
+    NUM_KEY("Service", "batch_wait_ms", CFG_INT, service_batch_wait_ms, 0, 100, 0),
+};
+
+#define NUM_CONFIG_KEYS ((int)(sizeof(g_keys_table) / sizeof(g_keys_table[0])))
+
+void config_set_defaults(AppConfig* c) {
+    memset(c, 0, sizeof(*c));
+    strcpy(c->device, "/dev/video0");
+    c->width = 1280;
+    c->height = 720;
+    c->fps = 30;
+    c->buffers = 4;
+    strcpy(c->vehicle_model, "models/yolov5s.onnx");
+    strcpy(c->plate_model, "models/ppocr_det_v4.onnx");
+    strcpy(c->ocr_model, "models/ppocr_rec_v4.onnx");
+    strcpy(c->ocr_keys, "models/ppocr_keys_v1.txt");
+    strcpy(c->vehicle_providers, "cpu");
+    strcpy(c->plate_providers, "cpu");
+    strcpy(c->ocr_providers, "cpu");
+    c->threshold = 0.25f;
+    c->plate_threshold = 0.3f;
+    c->ocr_threshold = 0.5f;
+    c->nms_threshold = 0.45f;
+    c->processing_interval = 100;
+    c->latency_budget_ms = 300;
+    c->activity_hold_ms = 2000;
+    c->max_detection_per_frame = 5;
+    c->enable_anti_fraud = 1;
+    c->intra_op_threads = 0;
+    c->inter_op_threads = 0;
+    c->allow_spinning = 1;
+    c->graph_optimization = 3;
+    c->parallel_execution = 0;
+    c->vehicle_workers = 2;
+    c->yolo_input_size = 640;
+    c->det_size = 640;
+    c->ocr_input_width = 320;
+    c->quality_min_score = 0.35f;
+    c->quality_improve_margin = 0.05f;
+    strcpy(c->list_file, "config/plate_list.txt");
+    c->list_max_edits = 1;
+    c->list_allow_max_edits = 0;
+    strcpy(c->event_dir, "events");
+    c->event_queue_size = 256;
+    c->event_crop_drop_percent = 50;
+    c->event_jpeg_quality = 85;
+    c->event_save_crops = 1;
+    c->event_jsonl = 1;
+    c->event_binary = 0;
+    c->store_enable = 1;
+    strcpy(c->store_dir, "store");
+    c->store_segment_records = 65536;
+    c->store_merge_records = 4194304;
+    c->store_retention_days = 180;
+    c->affinity_enable = 1;
+    c->capture_fifo = 0;
+    c->capture_priority = 50;
+    strcpy(c->trace_dir, "traces");
+    c->trace_frames = 30;
+    c->trace_ort_profile = 1;
+    c->cascade_enable = 1;
+    c->cascade_fast_width = 160;
+    c->cascade_accept = 0.9f;
+    strcpy(c->cascade_recrop, "1.5,1.6 2.2,2.5");
+    strcpy(c->pipeline_mode, "cascade");
+    c->frame_det_size = 1280;
+    c->powersave_enable = 0;
+    c->powersave_idle_s = 600;
+    c->powersave_width = 320;
+    c->powersave_height = 240;
+    c->powersave_fps = 2;
+    c->powersave_cell_delta = 12;
+    c->powersave_motion_cells = 0.01f;
+    c->service_slots = 2;
+    c->service_max_batch = 8;
+}
+
+static char* trim(char* s) {
+    while (isspace((unsigned char)*s)) s++;
+    char* e = s + strlen(s);
+    while (e > s && isspace((unsigned char)e[-1])) e--;
+    *e = '\0';
+    return s;
+}
+
+static int set_value(AppConfig* c, const ConfigKey* k, const char* val, const char* path, int line) {
+    char* base = (char*)c + k->offset;
+    char* end = NULL;
+
+    switch (k->type) {
+    case CFG_STR:
+        if (strlen(val) >= k->size) {
+            printf("[Config] %s:%d %s 过长\n", path, line, k->key);
+            return -1;
+        }
+        strcpy(base, val);
+        return 0;
+    case CFG_CHOICE: {
+        size_t len = strlen(val);
+        for (const char* c = k->choices; *c; ) {
+            size_t n = strcspn(c, " ");
+            if (n == len && strncmp(c, val, n) == 0 && len < k->size) {
+                strcpy(base, val);
+                return 0;
+            }
+            c += n;
+            while (*c == ' ') c++;
+        }
+        printf("[Config] %s:%d %s 取值无效: %s (可选 %s)\n", path, line, k->key, val, k->choices);
+        return -1;
+    }
+    case CFG_BOOL:
+        if (!strcasecmp(val, "true") || !strcasecmp(val, "yes") || !strcmp(val, "1")) *(int*)base = 1;
+        else if (!strcasecmp(val, "false") || !strcasecmp(val, "no") || !strcmp(val, "0")) *(int*)base = 0;
+        else {
+            printf("[Config] %s:%d %s 不是布尔值: %s\n", path, line, k->key, val);
+            return -1;
+        }
+        return 0;
+    case CFG_INT: {
+        long v = strtol(val, &end, 10);
+        if (end == val || *end != '\0' || v < k->min || v > k->max) {
+            printf("[Config] %s:%d %s 取值无效: %s (范围 %.0f-%.0f)\n", path, line, k->key, val, k->min, k->max);
+            return -1;
+        }
+        *(int*)base = (int)v;
+        return 0;
+    }
+    case CFG_FLOAT: {
+        float v = strtof(val, &end);
+        if (end == val || *end != '\0' || v < k->min || v > k->max) {
+            printf("[Config] %s:%d %s 取值无效: %s (范围 %.2f-%.2f)\n", path, line, k->key, val, k->min, k->max);
+            return -1;
+        }
+        *(float*)base = v;
+        return 0;
+    }
+    case CFG_POLY: {
+        // "x,y x,y ..." 空值表示整帧
+        RoiPolygon poly;
+        memset(&poly, 0, sizeof(poly));
+        const char* p = val;
+        while (*p) {
+            int x, y, n = 0;
+            if (poly.count >= ROI_MAX_POINTS || sscanf(p, " %d , %d%n", &x, &y, &n) != 2 || x < 0 || y < 0) {
+                printf("[Config] %s:%d %s 取值无效: %s (格式 x,y x,y ..., 最多 %d 个点)\n",
+                       path, line, k->key, val, ROI_MAX_POINTS);
+                return -1;
+            }
+            poly.x[poly.count] = x;
+            poly.y[poly.count] = y;
+            poly.count++;
+            p += n;
+            while (isspace((unsigned char)*p)) p++;
+        }
+        if (poly.count == 1 ||
+            (poly.count == 2 && (poly.x[1] <= poly.x[0] || poly.y[1] <= poly.y[0]))) {
+            printf("[Config] %s:%d %s 需要矩形的左上/右下两点或至少 3 个多边形顶点\n", path, line, k->key);
+            return -1;
+        }
+        memcpy(base, &poly, sizeof(poly));
+        return 0;
+    }
+    }
+    return -1;
+}
 
 int load_config(const char* path, AppConfig* config) {
-    // 简化实现，这里直接忽略文件读取，使用默认值
-    (void)path; (void)config;
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        printf("[Config] 无法打开配置文件 %s, 使用默认值\n", path);
+        return -1;
+    }
+
+    // 先解析到临时副本, 任何一项出错则整体作废, 不会留下半更新的配置
+    AppConfig tmp = *config;
+    char section[32] = "";
+    char buf[512];
+    int line = 0, errors = 0;
+
+    while (fgets(buf, sizeof(buf), f)) {
+        line++;
+        char* s = trim(buf);
+        if (*s == '\0' || *s == '#' || *s == ';') continue;
+
+        if (*s == '[') {
+            char* e = strchr(s, ']');
+            if (!e) { printf("[Config] %s:%d 节名缺少 ']'\n", path, line); errors++; continue; }
+            *e = '\0';
+            snprintf(section, sizeof(section), "%s", trim(s + 1));
+            continue;
+        }
+
+        char* eq = strchr(s, '=');
+        if (!eq) { printf("[Config] %s:%d 无法解析: %s\n", path, line, s); errors++; continue; }
+        *eq = '\0';
+        char* key = trim(s);
+        char* val = trim(eq + 1);
+
+        int found = 0;
+        for (int i = 0; i < NUM_CONFIG_KEYS; i++) {
+            const ConfigKey* k = &g_keys_table[i];
+            if (strcasecmp(k->section, section) == 0 && strcmp(k->key, key) == 0) {
+                if (set_value(&tmp, k, val, path, line) != 0) errors++;
+                found = 1;
+                break;
+            }
+        }
+        if (!found) printf("[Config] %s:%d 忽略未知配置项 [%s] %s\n", path, line, section, key);
+    }
+    fclose(f);
+
+    if (errors > 0) {
+        printf("[Config] %s 有 %d 处错误, 未生效\n", path, errors);
+        return -1;
+    }
+    *config = tmp;
+    return 0;
+}
+
+// ---------------------------------------------------------------
+// 配置快照: 发布后只读, 引用计数归零时释放
+// ---------------------------------------------------------------
+
+typedef struct {
+    AppConfig cfg;   // 必须是第一个成员, config_release 依赖该布局
+    int refs;
+} ConfigSnapshot;
+
+static pthread_mutex_t g_snap_lock = PTHREAD_MUTEX_INITIALIZER;
+static ConfigSnapshot* g_current = NULL;
+static int g_version = 0;
+
+int config_publish(const AppConfig* config) {
+    ConfigSnapshot* snap = malloc(sizeof(ConfigSnapshot));
+    if (!snap) return -1;
+    snap->cfg = *config;
+    snap->refs = 1; // 由 g_current 持有
+
+    pthread_mutex_lock(&g_snap_lock);
+    snap->cfg.version = ++g_version;
+    ConfigSnapshot* old = g_current;
+    g_current = snap;
+    int free_old = old && --old->refs == 0;
+    pthread_mutex_unlock(&g_snap_lock);
+
+    if (free_old) free(old);
+    return 0;
+}
+
+const AppConfig* config_acquire() {
+    pthread_mutex_lock(&g_snap_lock);
+    ConfigSnapshot* snap = g_current;
+    if (snap) snap->refs++;
+    pthread_mutex_unlock(&g_snap_lock);
+    return snap ? &snap->cfg : NULL;
+}
+
+void config_release(const AppConfig* config) {
+    if (!config) return;
+    ConfigSnapshot* snap = (ConfigSnapshot*)config;
+    pthread_mutex_lock(&g_snap_lock);
+    int free_it = --snap->refs == 0;
+    pthread_mutex_unlock(&g_snap_lock);
+    if (free_it) free(snap);
+}
+
+// ---------------------------------------------------------------
+// 热加载: inotify 监听配置文件所在目录
+// (编辑器常以"写临时文件 + rename"方式保存, 直接监听文件会丢失事件)
+// ---------------------------------------------------------------
+
+static pthread_t g_watch_thread;
+static volatile int g_watch_running = 0;
+static char g_watch_path[256];
+
+// 被监听的文件 (配置文件、名单文件等), 共用一个 inotify 线程
+#define MAX_WATCHES 8
+typedef struct {
+    int wd;
+    char name[256];
+    char path[256];
+    file_change_cb cb;
+    int changed;
+} FileWatch;
+
+static pthread_mutex_t g_watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static FileWatch g_watches[MAX_WATCHES];
+static int g_num_watches = 0;
+static int g_inotify_fd = -1;
+
+int file_watch_add(const char* path, file_change_cb cb) {
+    char dir[256];
+    const char* slash = strrchr(path, '/');
+    if (slash) snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    else strcpy(dir, ".");
+
+    pthread_mutex_lock(&g_watch_lock);
+    int ret = -1;
+    if (g_inotify_fd < 0) g_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (g_inotify_fd >= 0 && g_num_watches < MAX_WATCHES) {
+        // 同一目录重复添加返回相同的 wd
+        int wd = inotify_add_watch(g_inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd >= 0) {
+            FileWatch* w = &g_watches[g_num_watches++];
+            w->wd = wd;
+            snprintf(w->name, sizeof(w->name), "%s", slash ? slash + 1 : path);
+            snprintf(w->path, sizeof(w->path), "%s", path);
+            w->cb = cb;
+            w->changed = 0;
+            ret = 0;
+        }
+    }
+    pthread_mutex_unlock(&g_watch_lock);
+    if (ret != 0) perror("[Config] inotify 监听失败");
+    return ret;
+}
+
+// 记录需要重启才能生效的改动
+static void warn_restart_only(const AppConfig* old, const AppConfig* new_cfg) {
+    for (int i = 0; i < NUM_CONFIG_KEYS; i++) {
+        const ConfigKey* k = &g_keys_table[i];
+        if (k->live) continue;
+        size_t sz = k->size ? k->size : sizeof(int);
+        if (memcmp((const char*)old + k->offset, (const char*)new_cfg + k->offset, sz) != 0) {
+            printf("[Config] [%s] %s 已修改, 需重启后生效\n", k->section, k->key);
+        }
+    }
+}
+
+static void reload_config() {
+    const AppConfig* cur = config_acquire();
+    AppConfig next;
+    if (cur) next = *cur; else config_set_defaults(&next);
+
+    if (load_config(g_watch_path, &next) == 0) {
+        if (cur) {
+            warn_restart_only(cur, &next);
+            // 需重启的项保持运行中的值, 保证快照与已加载的模型/设备一致
+            for (int i = 0; i < NUM_CONFIG_KEYS; i++) {
+                const ConfigKey* k = &g_keys_table[i];
+                if (k->live) continue;
+                size_t sz = k->size ? k->size : sizeof(int);
+                memcpy((char*)&next + k->offset, (const char*)cur + k->offset, sz);
+            }
+        }
+        config_publish(&next);
+        printf("[Config] 配置已热加载 (版本 %d)\n", g_version);
+    }
+    config_release(cur);
+}
+
+// 读出全部待处理的 inotify 事件, 标记对应的监听文件; 有文件变化时返回 1
+static int drain_events(char* events, size_t size) {
+    int changed = 0;
+    ssize_t len;
+    while ((len = read(g_inotify_fd, events, size)) > 0) {
+        pthread_mutex_lock(&g_watch_lock);
+        for (char* p = events; p < events + len; ) {
+            struct inotify_event* ev = (struct inotify_event*)p;
+            for (int i = 0; i < g_num_watches; i++) {
+                if (ev->len > 0 && ev->wd == g_watches[i].wd && strcmp(ev->name, g_watches[i].name) == 0) {
+                    g_watches[i].changed = 1;
+                    changed = 1;
+                }
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+        pthread_mutex_unlock(&g_watch_lock);
+    }
+    return changed;
+}
+
+static void* watch_loop(void* arg) {
+    (void)arg;
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (g_watch_running) {
+        struct pollfd pfd = { .fd = g_inotify_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 500) <= 0) continue;
+        if (!drain_events(events, sizeof(events))) continue;
+
+        // 合并短时间内的连续写入; 期间到达的事件同样要标记 (可能是另一个文件的改动)
+        usleep(100 * 1000);
+        drain_events(events, sizeof(events));
+
+        for (int i = 0; i < g_num_watches; i++) {
+            pthread_mutex_lock(&g_watch_lock);
+            FileWatch w = g_watches[i];
+            g_watches[i].changed = 0;
+            pthread_mutex_unlock(&g_watch_lock);
+            if (w.changed) w.cb(w.path);
+        }
+    }
+    return NULL;
+}
+
+static void on_config_changed(const char* path) {
+    (void)path;
+    reload_config();
+}
+
+int config_watch_start(const char* path) {
+    if (g_watch_running) return 0;
+    snprintf(g_watch_path, sizeof(g_watch_path), "%s", path);
+    if (file_watch_add(path, on_config_changed) != 0) return -1;
+    g_watch_running = 1;
+    if (pthread_create(&g_watch_thread, NULL, watch_loop, NULL) != 0) {
+        g_watch_running = 0;
+        return -1;
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+void config_watch_stop() {
+    if (!g_watch_running) return;
+    g_watch_running = 0;
+    pthread_join(g_watch_thread, NULL);
+    close(g_inotify_fd);
+    g_inotify_fd = -1;
+    g_num_watches = 0;
+}
@@ -1,16 +1,17 @@
 #include "include/video_capture.h"
+#include "include/trace.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <linux/videodev2.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
-struct buffer { void* start; size_t length; };
-static struct buffer g_bufs[4];
-
 // YUYV -> RGB 转换
 static void yuyv_to_rgb(const unsigned char* yuyv, unsigned char* rgb, int width, int height) {
     int z = 0;
@@ -56,16 +57,8 @@ static void yuyv_to_rgb(const unsigned char* yuyv, unsigned char* rgb, int width
     #undef CLP
 }
 
-int camera_init(CameraContext* ctx, const char* dev, int w, int h) {
-    ctx->fd = open(dev, O_RDWR);
-    if(ctx->fd < 0) {
-        perror("无法打开摄像头设备");
-        return -1;
-    }
-    ctx->width = w; 
-    ctx->height = h;
-    ctx->buffer_rgb = malloc(w * h * 3);
-
+// 设置分辨率与帧率; 驱动可能调整分辨率, 以驱动返回的为准
+static int set_format(CameraContext* ctx, int w, int h, int fps) {
     struct v4l2_format fmt = {0};
     fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     fmt.fmt.pix.width = w;
@@ -76,68 +69,246 @@ int camera_init(CameraContext* ctx, const char* dev, int w, int h) {
         perror("设置像素格式失败");
         return -1;
     }
+    if ((int)fmt.fmt.pix.width != w || (int)fmt.fmt.pix.height != h) {
+        printf("[Camera] 驱动把分辨率 %dx%d 调整为 %ux%u\n", w, h, fmt.fmt.pix.width, fmt.fmt.pix.height);
+    }
+    ctx->width = fmt.fmt.pix.width;
+    ctx->height = fmt.fmt.pix.height;
 
+    // 帧率: 不支持 S_PARM 的驱动保持默认帧率
+    struct v4l2_streamparm parm = {0};
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = fps;
+    if (fps > 0 && ioctl(ctx->fd, VIDIOC_S_PARM, &parm) == 0 && parm.parm.capture.timeperframe.numerator > 0) {
+        ctx->fps = parm.parm.capture.timeperframe.denominator / parm.parm.capture.timeperframe.numerator;
+    } else {
+        ctx->fps = 0;
+    }
+    return 0;
+}
+
+// 申请并映射驱动缓冲区, 全部入队后开启视频流
+static int start_stream(CameraContext* ctx) {
     struct v4l2_requestbuffers req = {0};
-    req.count = 4;
+    req.count = ctx->buffers_wanted;
     req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     req.memory = V4L2_MEMORY_MMAP;
-    if (ioctl(ctx->fd, VIDIOC_REQBUFS, &req) < 0) {
+    if (ioctl(ctx->fd, VIDIOC_REQBUFS, &req) < 0 || req.count < 1) {
         perror("申请缓冲区失败");
         return -1;
     }
+    ctx->buf_count = req.count < CAMERA_MAX_BUFFERS ? (int)req.count : CAMERA_MAX_BUFFERS;
 
-    for (int i = 0; i < 4; ++i) {
+    int exported = 0;
+    for (int i = 0; i < ctx->buf_count; ++i) {
         struct v4l2_buffer buf = {0};
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
         buf.memory = V4L2_MEMORY_MMAP;
         buf.index = i;
         ioctl(ctx->fd, VIDIOC_QUERYBUF, &buf);
-        g_bufs[i].length = buf.length;
-        g_bufs[i].start = mmap(NULL, buf.length, PROT_READ|PROT_WRITE, MAP_SHARED, ctx->fd, buf.m.offset);
-        if (g_bufs[i].start == MAP_FAILED) {
+        ctx->bufs[i].length = buf.length;
+        ctx->bufs[i].start = mmap(NULL, buf.length, PROT_READ|PROT_WRITE, MAP_SHARED, ctx->fd, buf.m.offset);
+        if (ctx->bufs[i].start == MAP_FAILED) {
+            ctx->bufs[i].start = NULL;
             perror("mmap 失败");
             return -1;
         }
+        if (ctx->export_dmabuf) {
+            struct v4l2_exportbuffer exp = {0};
+            exp.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            exp.index = i;
+            exp.flags = O_RDONLY | O_CLOEXEC;
+            if (ioctl(ctx->fd, VIDIOC_EXPBUF, &exp) == 0) {
+                ctx->bufs[i].dmabuf_fd = exp.fd;
+                exported++;
+            }
+        }
         ioctl(ctx->fd, VIDIOC_QBUF, &buf);
     }
-    
+    if (ctx->export_dmabuf && exported < ctx->buf_count) {
+        printf("[Camera] 驱动不支持导出 DMABUF (%d/%d)\n", exported, ctx->buf_count);
+    }
+    ctx->dmabuf_exported = exported == ctx->buf_count;
+
     int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     if (ioctl(ctx->fd, VIDIOC_STREAMON, &type) < 0) {
         perror("开启视频流失败");
         return -1;
     }
+    // 重新开流后驱动帧序号从 0 开始
+    ctx->have_sequence = 0;
+    ctx->held = 0;
     return 0;
 }
 
-int camera_capture(CameraContext* ctx, unsigned char** out) {
+// 关闭视频流并释放驱动缓冲区
+static void stop_stream(CameraContext* ctx) {
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    ioctl(ctx->fd, VIDIOC_STREAMOFF, &type);
+    for(int i=0; i<ctx->buf_count; i++) {
+        if (ctx->bufs[i].start) munmap(ctx->bufs[i].start, ctx->bufs[i].length);
+        if (ctx->bufs[i].dmabuf_fd >= 0) close(ctx->bufs[i].dmabuf_fd);
+        ctx->bufs[i].start = NULL;
+        ctx->bufs[i].dmabuf_fd = -1;
+    }
+    ctx->buf_count = 0;
+    struct v4l2_requestbuffers req = {0};
+    req.count = 0;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    ioctl(ctx->fd, VIDIOC_REQBUFS, &req);
+}
+
+int camera_init(CameraContext* ctx, const char* dev, int w, int h, int fps, int buffers, int export_dmabuf) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->epfd = -1;
+    // 非阻塞打开: 没有新帧时 DQBUF 立即返回 EAGAIN, 由 epoll 等待
+    ctx->fd = open(dev, O_RDWR | O_NONBLOCK);
+    if(ctx->fd < 0) {
+        perror("无法打开摄像头设备");
+        return -1;
+    }
+    for (int i = 0; i < CAMERA_MAX_BUFFERS; i++) ctx->bufs[i].dmabuf_fd = -1;
+    if (set_format(ctx, w, h, fps) != 0) return -1;
+    ctx->buffer_rgb = malloc((size_t)ctx->width * ctx->height * 3);
+    ctx->rgb_capacity = (size_t)ctx->width * ctx->height * 3;
+
+    // 缓冲区数: 处理线程持有的帧之外还要留给驱动写入, 否则驱动只能丢帧
+    if (buffers < 2) buffers = 2;
+    if (buffers > CAMERA_MAX_BUFFERS) buffers = CAMERA_MAX_BUFFERS;
+    ctx->buffers_wanted = buffers;
+    ctx->export_dmabuf = export_dmabuf;
+
+    ctx->epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN };
+    if (ctx->epfd < 0 || epoll_ctl(ctx->epfd, EPOLL_CTL_ADD, ctx->fd, &ev) < 0) {
+        perror("epoll 初始化失败");
+        return -1;
+    }
+    if (start_stream(ctx) != 0) return -1;
+    printf("[Camera] %s %dx%d @ %dfps, 驱动缓冲区 %d 个%s\n", dev, ctx->width, ctx->height, ctx->fps, ctx->buf_count,
+           ctx->dmabuf_exported ? ", 已导出 DMABUF" : "");
+    return 0;
+}
+
+int camera_reconfigure(CameraContext* ctx, int w, int h, int fps) {
+    if (ctx->held > 0) return -1;
+    // 运行中不能改格式: 先停流并释放缓冲区
+    stop_stream(ctx);
+    if (set_format(ctx, w, h, fps) != 0) return -1;
+    size_t need = (size_t)ctx->width * ctx->height * 3;
+    if (need > ctx->rgb_capacity) {
+        unsigned char* p = realloc(ctx->buffer_rgb, need);
+        if (!p) return -1;
+        ctx->buffer_rgb = p;
+        ctx->rgb_capacity = need;
+    }
+    return start_stream(ctx);
+}
+
+// 帧序号不连续: 中间的帧在驱动里被丢弃了. 出错归还的帧同样要推进序号, 否则会再被计为丢帧
+static void advance_sequence(CameraContext* ctx, uint32_t sequence) {
+    if (ctx->have_sequence && sequence > ctx->last_sequence + 1) {
+        ctx->dropped += sequence - ctx->last_sequence - 1;
+    }
+    ctx->last_sequence = sequence;
+    ctx->have_sequence = 1;
+}
+
+int camera_dequeue(CameraContext* ctx, CameraFrame* frame, int timeout_ms) {
     struct v4l2_buffer buf = {0};
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     buf.memory = V4L2_MEMORY_MMAP;
     
-    // 从队列中取出一帧
-    if (ioctl(ctx->fd, VIDIOC_DQBUF, &buf) < 0) {
-        return -1;
+    // 从队列中取出一帧; 队列为空时等待驱动通知 (EINTR 时返回, 让调用方检查退出标志)
+    uint64_t t = trace_begin();
+    for (;;) {
+        if (ioctl(ctx->fd, VIDIOC_DQBUF, &buf) == 0) {
+            if (buf.flags & V4L2_BUF_FLAG_ERROR) {
+                // 传输出错的帧数据不完整, 直接归还
+                ctx->corrupted++;
+                advance_sequence(ctx, buf.sequence);
+                ioctl(ctx->fd, VIDIOC_QBUF, &buf);
+                continue;
+            }
+            break;
+        }
+        if (errno != EAGAIN) return -1;
+        struct epoll_event ev;
+        int n = epoll_wait(ctx->epfd, &ev, 1, timeout_ms);
+        if (n == 0 || (n < 0 && errno == EINTR)) return 1;
+        if (n < 0) return -1;
     }
+    trace_end(t, "capture.dequeue", -1);
     
+    // 采集时间戳: 驱动给出 MONOTONIC 时间戳则直接使用, 否则以出队时间代替
+    if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        ctx->timestamp_us = (uint64_t)buf.timestamp.tv_sec * 1000000ULL + buf.timestamp.tv_usec;
+    } else {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ctx->timestamp_us = (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    }
+
+    advance_sequence(ctx, buf.sequence);
+    ctx->frames++;
+    ctx->held++;
+
+    frame->index = buf.index;
+    frame->data = ctx->bufs[buf.index].start;
+    frame->bytes = buf.bytesused;
+    frame->dmabuf_fd = ctx->bufs[buf.index].dmabuf_fd;
+    frame->sequence = buf.sequence;
+    frame->timestamp_us = ctx->timestamp_us;
+    return 0;
+}
+
+void camera_convert(CameraContext* ctx, const CameraFrame* frame, unsigned char* rgb) {
     // 转码: YUYV -> RGB
-    yuyv_to_rgb((unsigned char*)g_bufs[buf.index].start, ctx->buffer_rgb, ctx->width, ctx->height);
-    
+    uint64_t t = trace_begin();
+    yuyv_to_rgb(frame->data, rgb, ctx->width, ctx->height);
+    trace_end(t, "capture.yuyv_to_rgb", -1);
+}
+
+void camera_release(CameraContext* ctx, const CameraFrame* frame) {
+    struct v4l2_buffer buf = {0};
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = frame->index;
+    // 将缓冲区放回队列
+    if (ioctl(ctx->fd, VIDIOC_QBUF, &buf) == 0) ctx->held--;
+}
+
+int camera_capture(CameraContext* ctx, unsigned char** out) {
+    if (camera_capture_to(ctx, ctx->buffer_rgb) != 0) return -1;
     // 返回 RGB 数据指针
     *out = ctx->buffer_rgb;
-    
-    // 将缓冲区放回队列
-    ioctl(ctx->fd, VIDIOC_QBUF, &buf);
     return 0;
 }
 
+int camera_capture_to(CameraContext* ctx, unsigned char* rgb) {
+    CameraFrame frame;
+    if (camera_dequeue(ctx, &frame, -1) != 0) return -1;
+    camera_convert(ctx, &frame, rgb);
+    camera_release(ctx, &frame);
+    return 0;
+}
+
+void camera_report(CameraContext* ctx, uint64_t now, int interval_s) {
+    if (ctx->last_report == 0) { ctx->last_report = now; return; }
+    if (now - ctx->last_report < (uint64_t)interval_s * 1000000ULL) return;
+    ctx->last_report = now;
+
+    printf("\n[Camera] 采集 %lu | 驱动丢帧 %lu | 损坏 %lu | 持有缓冲区 %d/%d\n",
+           ctx->frames, ctx->dropped, ctx->corrupted, ctx->held, ctx->buf_count);
+}
+
 void camera_close(CameraContext* ctx) {
     if (ctx->buffer_rgb) free(ctx->buffer_rgb);
+    if (ctx->epfd >= 0) close(ctx->epfd);
     if (ctx->fd >= 0) {
-        int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        ioctl(ctx->fd, VIDIOC_STREAMOFF, &type);
-        for(int i=0; i<4; i++) {
-            if (g_bufs[i].start) munmap(g_bufs[i].start, g_bufs[i].length);
-        }
+        stop_stream(ctx);
         close(ctx->fd);
     }
-}
\ No newline at end of file
+}